@@ -0,0 +1,11 @@
+/* Host stand-in for the bin2o generated EHCI module header */
+
+#ifndef _EHCMODULE_ELF_H_
+#define _EHCMODULE_ELF_H_
+
+#include "gctypes.h"
+
+extern const u8 ehcmodule_elf[];
+extern const u32 ehcmodule_elf_size;
+
+#endif
@@ -0,0 +1,33 @@
+/* Host stand-in for libogc's gccore.h */
+
+#ifndef __GCCORE_H__
+#define __GCCORE_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gctypes.h"
+#include "ogc/ipc.h"
+#include "ogc/isfs.h"
+#include "ogc/es.h"
+#include "ogc/aes.h"
+#include "ogc/lwp.h"
+#include "ogc/mutex.h"
+#include "ogc/cond.h"
+#include "ogc/cache.h"
+#include "ogc/lwp_watchdog.h"
+
+typedef struct _gx_rmodeobj GXRModeObj;
+
+typedef void (*resetcallback)(u32 irq, void* ctx);
+typedef void (*powercallback)(void);
+
+void VIDEO_Init(void);
+resetcallback SYS_SetResetCallback(resetcallback cb);
+powercallback SYS_SetPowerCallback(powercallback cb);
+
+s32 STM_RebootSystem(void);
+s32 STM_ShutdownToStandby(void);
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * Host stand-in for libogc's gctypes.h.
+ *
+ * On-disc and on-NAND structures are big-endian. Packed structures are
+ * declared with big-endian scalar storage order so the WAD engine can
+ * read real WADs and NAND dumps on a little-endian host unchanged.
+ */
+
+#ifndef __GCTYPES_H__
+#define __GCTYPES_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int8_t  s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef volatile u8  vu8;
+typedef volatile u16 vu16;
+typedef volatile u32 vu32;
+typedef volatile u64 vu64;
+
+typedef volatile s8  vs8;
+typedef volatile s16 vs16;
+typedef volatile s32 vs32;
+typedef volatile s64 vs64;
+
+typedef float  f32;
+typedef double f64;
+
+#define ATTRIBUTE_ALIGN(v)	__attribute__((aligned(v)))
+#define ATTRIBUTE_PACKED	__attribute__((packed, scalar_storage_order("big-endian")))
+
+#ifndef __aligned
+#define __aligned(x)		__attribute__((aligned(x)))
+#endif
+
+#endif
@@ -0,0 +1,13 @@
+/* Host stand-in for libogc's aes.h (AES-128-CBC, IV updated in place) */
+
+#ifndef __AES_H__
+#define __AES_H__
+
+#include "gctypes.h"
+
+s32 AES_Init(void);
+s32 AES_Close(void);
+s32 AES_Encrypt(const void* key, u32 key_size, void* iv, u32 iv_size, const void* in, void* out, u32 size);
+s32 AES_Decrypt(const void* key, u32 key_size, void* iv, u32 iv_size, const void* in, void* out, u32 size);
+
+#endif
@@ -0,0 +1,11 @@
+/* Host stand-in for libogc's cache.h. There are no caches to maintain. */
+
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include "gctypes.h"
+
+static inline void DCFlushRange(void* startaddress, u32 len) { (void)startaddress; (void)len; }
+static inline void ICInvalidateRange(void* startaddress, u32 len) { (void)startaddress; (void)len; }
+
+#endif
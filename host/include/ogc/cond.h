@@ -0,0 +1,19 @@
+/* Host stand-in for libogc's cond.h, implemented on top of pthreads */
+
+#ifndef __COND_H__
+#define __COND_H__
+
+#include "gctypes.h"
+#include "ogc/mutex.h"
+
+#define LWP_COND_NULL		0xffffffff
+
+typedef u32 cond_t;
+
+s32 LWP_CondInit(cond_t* cond);
+s32 LWP_CondWait(cond_t cond, mutex_t mutex);
+s32 LWP_CondSignal(cond_t cond);
+s32 LWP_CondBroadcast(cond_t cond);
+s32 LWP_CondDestroy(cond_t cond);
+
+#endif
@@ -0,0 +1,192 @@
+/*
+ * Host stand-in for libogc's es.h.
+ *
+ * Structure layouts match libogc. They are declared ATTRIBUTE_PACKED, which
+ * on the host also makes them big-endian, so tickets and TMDs can be used
+ * straight from WAD files.
+ */
+
+#ifndef __ES_H__
+#define __ES_H__
+
+#include "gctypes.h"
+
+#define ES_EINVAL			-0x1004
+#define ES_ENOMEM			-0x100C
+#define ES_ENOTINIT			-0x1100
+#define ES_EALIGN			-0x1101
+
+#define ES_SIG_RSA4096		0x10000
+#define ES_SIG_RSA2048		0x10001
+#define ES_SIG_ECDSA		0x10002
+
+#define ES_CERT_RSA4096		0
+#define ES_CERT_RSA2048		1
+#define ES_CERT_ECDSA		2
+
+typedef u32 signed_blob;
+
+typedef u8 sha1[20];
+typedef u8 aeskey[16];
+
+typedef struct _sig_rsa2048 {
+	u32 type;
+	u8 sig[256];
+	u8 fill[60];
+} ATTRIBUTE_PACKED sig_rsa2048;
+
+typedef struct _sig_rsa4096 {
+	u32 type;
+	u8 sig[512];
+	u8 fill[60];
+} ATTRIBUTE_PACKED sig_rsa4096;
+
+typedef struct _sig_ecdsa {
+	u32 type;
+	u8 sig[60];
+	u8 fill[64];
+} ATTRIBUTE_PACKED sig_ecdsa;
+
+typedef struct _tiklimit {
+	u32 tag;
+	u32 value;
+} ATTRIBUTE_PACKED tiklimit;
+
+typedef struct _tikview {
+	u32 view;
+	u64 ticketid;
+	u32 devicetype;
+	u64 titleid;
+	u16 access_mask;
+	u8 reserved[0x3c];
+	u8 cidx_mask[0x40];
+	u16 padding;
+	tiklimit limits[8];
+} ATTRIBUTE_PACKED tikview;
+
+typedef struct _tik {
+	char issuer[0x40];
+	u8 fill[63];
+	aeskey cipher_title_key;
+	u8 fill2;
+	u64 ticketid;
+	u32 devicetype;
+	u64 titleid;
+	u16 access_mask;
+	u8 reserved[0x3c];
+	u8 cidx_mask[0x40];
+	u16 padding;
+	tiklimit limits[8];
+} ATTRIBUTE_PACKED tik;
+
+typedef struct _tmd_content {
+	u32 cid;
+	u16 index;
+	u16 type;
+	u64 size;
+	sha1 hash;
+} ATTRIBUTE_PACKED tmd_content;
+
+typedef struct _tmd {
+	char issuer[64];
+	u8 version;
+	u8 ca_crl_version;
+	u8 signer_crl_version;
+	u8 vwii_title;
+	u64 sys_version;
+	u64 title_id;
+	u32 title_type;
+	u16 group_id;
+	u16 zero;
+	u16 region;
+	u8 ratings[16];
+	u8 reserved[12];
+	u8 ipc_mask[12];
+	u8 reserved2[18];
+	u32 access_rights;
+	u16 title_version;
+	u16 num_contents;
+	u16 boot_index;
+	u16 fill3;
+	tmd_content contents[];
+} ATTRIBUTE_PACKED tmd;
+
+typedef struct _tmd_view_content {
+	u32 cid;
+	u16 index;
+	u16 type;
+	u64 size;
+} ATTRIBUTE_PACKED tmd_view_content;
+
+typedef struct _tmdview {
+	u8 version;
+	u8 filler[3];
+	u64 sys_version;
+	u64 title_id;
+	u32 title_type;
+	u16 group_id;
+	u8 reserved[0x3e];
+	u16 title_version;
+	u16 num_contents;
+	tmd_view_content contents[];
+} ATTRIBUTE_PACKED tmd_view;
+
+/* The signature type is the first big-endian word of every signed blob */
+static inline u32 __es_sig_type(const signed_blob* blob)
+{
+	const u8* p = (const u8*)blob;
+	return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+}
+
+#define SIGNATURE_SIZE(x) (\
+	(__es_sig_type(x) == ES_SIG_RSA2048) ? sizeof(sig_rsa2048) : ( \
+	(__es_sig_type(x) == ES_SIG_RSA4096) ? sizeof(sig_rsa4096) : ( \
+	(__es_sig_type(x) == ES_SIG_ECDSA) ? sizeof(sig_ecdsa) : 0 )))
+
+#define IS_VALID_SIGNATURE(x) (\
+	__es_sig_type(x) == ES_SIG_RSA2048 || \
+	__es_sig_type(x) == ES_SIG_RSA4096 || \
+	__es_sig_type(x) == ES_SIG_ECDSA)
+
+#define SIGNATURE_SIG(x)		(((u8*)(x)) + 4)
+#define SIGNATURE_PAYLOAD(x)	((void*)(((u8*)(x)) + SIGNATURE_SIZE(x)))
+
+#define TMD_SIZE(x)				(((x)->num_contents) * sizeof(tmd_content) + sizeof(tmd))
+
+#define MAX_NUM_TMD_CONTENTS	512
+#define MAX_TMD_SIZE			(sizeof(tmd) + MAX_NUM_TMD_CONTENTS * sizeof(tmd_content))
+#define MAX_SIGNED_TMD_SIZE		(MAX_TMD_SIZE + sizeof(sig_rsa2048))
+
+s32 __ES_Init(void);
+s32 __ES_Close(void);
+
+s32 ES_GetTitleID(u64* titleID);
+s32 ES_GetDataDir(u64 titleID, char* filepath);
+s32 ES_GetNumTitles(u32* cnt);
+s32 ES_GetTitles(u64* titles, u32 cnt);
+s32 ES_GetDeviceID(u32* device_id);
+s32 ES_GetBoot2Version(u32* version);
+
+s32 ES_GetStoredTMDSize(u64 titleID, u32* size);
+s32 ES_GetStoredTMD(u64 titleID, signed_blob* stmd, u32 size);
+s32 ES_GetStoredContentCnt(u64 titleID, u32* cnt);
+s32 ES_GetStoredContents(u64 titleID, u32* contents, u32 cnt);
+s32 ES_GetTMDViewSize(u64 titleID, u32* size);
+s32 ES_GetTMDView(u64 titleID, u8* data, u32 size);
+
+s32 ES_GetNumTicketViews(u64 titleID, u32* cnt);
+s32 ES_GetTicketViews(u64 titleID, tikview* views, u32 cnt);
+
+s32 ES_AddTicket(const signed_blob* tik, u32 tik_size, const signed_blob* certificates, u32 certificates_size, const signed_blob* crl, u32 crl_size);
+s32 ES_AddTitleStart(const signed_blob* tmd, u32 tmd_size, const signed_blob* certificates, u32 certificates_size, const signed_blob* crl, u32 crl_size);
+s32 ES_AddContentStart(u64 titleID, u32 cid);
+s32 ES_AddContentData(s32 cid, u8* data, u32 data_size);
+s32 ES_AddContentFinish(u32 cid);
+s32 ES_AddTitleFinish(void);
+s32 ES_AddTitleCancel(void);
+
+s32 ES_DeleteTitle(u64 titleID);
+s32 ES_DeleteTitleContent(u64 titleID);
+s32 ES_DeleteTicket(const tikview* view);
+
+#endif
@@ -0,0 +1,33 @@
+/* Host stand-in for libogc's ipc.h, backed by the stand-in NAND directory */
+
+#ifndef __IPC_H__
+#define __IPC_H__
+
+#include "gctypes.h"
+
+#define IPC_OK			0
+#define IPC_EINVAL		-4
+#define IPC_ENOHEAP		-5
+#define IPC_ENOENT		-6
+#define IPC_EQUEUEFULL	-8
+#define IPC_ENOMEM		-22
+
+typedef struct _ioctlv
+{
+	void* data;
+	u32 len;
+} ioctlv;
+
+s32 IOS_Open(const char* filepath, u32 mode);
+s32 IOS_Close(s32 fd);
+s32 IOS_Seek(s32 fd, s32 where, s32 whence);
+s32 IOS_Read(s32 fd, void* buf, s32 len);
+s32 IOS_Write(s32 fd, const void* buf, s32 len);
+s32 IOS_Ioctl(s32 fd, s32 ioctl, void* buffer_in, s32 len_in, void* buffer_io, s32 len_io);
+s32 IOS_Ioctlv(s32 fd, s32 ioctl, s32 cnt_in, s32 cnt_io, ioctlv* argv);
+
+s32 IOS_GetVersion(void);
+s32 IOS_GetRevision(void);
+s32 IOS_ReloadIOS(int version);
+
+#endif
@@ -0,0 +1,31 @@
+/* Host stand-in for libogc's isfs.h, backed by the stand-in NAND directory */
+
+#ifndef __ISFS_H__
+#define __ISFS_H__
+
+#include "gctypes.h"
+
+#define ISFS_MAXPATH		64
+
+#define ISFS_OPEN_READ		0x01
+#define ISFS_OPEN_WRITE		0x02
+#define ISFS_OPEN_RW		(ISFS_OPEN_READ | ISFS_OPEN_WRITE)
+
+#define ISFS_OK				0
+#define ISFS_ENOMEM			-22
+#define ISFS_EINVAL			-101
+
+s32 ISFS_Initialize(void);
+s32 ISFS_Deinitialize(void);
+s32 ISFS_Open(const char* filepath, u8 mode);
+s32 ISFS_Close(s32 fd);
+s32 ISFS_Seek(s32 fd, s32 where, s32 whence);
+s32 ISFS_Read(s32 fd, void* buffer, u32 length);
+s32 ISFS_Write(s32 fd, const void* buffer, u32 length);
+s32 ISFS_CreateFile(const char* filepath, u8 attributes, u8 owner_perm, u8 group_perm, u8 other_perm);
+s32 ISFS_Delete(const char* filepath);
+s32 ISFS_Rename(const char* filepathOld, const char* filepathNew);
+s32 ISFS_GetStats(void* stats);
+s32 ISFS_GetUsage(const char* filepath, u32* usage1, u32* usage2);
+
+#endif
@@ -0,0 +1,16 @@
+/* Host stand-in for libogc's lwp.h, implemented on top of pthreads */
+
+#ifndef __LWP_H__
+#define __LWP_H__
+
+#include "gctypes.h"
+
+#define LWP_THREAD_NULL		0xffffffff
+
+typedef u32 lwp_t;
+
+s32 LWP_CreateThread(lwp_t* thethread, void* (*entry)(void*), void* arg, void* stackbase, u32 stack_size, u8 prio);
+s32 LWP_JoinThread(lwp_t thethread, void** value_ptr);
+void LWP_YieldThread(void);
+
+#endif
@@ -0,0 +1,13 @@
+/* Host stand-in for libogc's lwp_watchdog.h. One tick is one nanosecond. */
+
+#ifndef __LWP_WATCHDOG_H__
+#define __LWP_WATCHDOG_H__
+
+#include "gctypes.h"
+
+u64 gettime(void);
+u32 diff_sec(u64 start, u64 end);
+u32 diff_msec(u64 start, u64 end);
+u32 diff_usec(u64 start, u64 end);
+
+#endif
@@ -0,0 +1,13 @@
+/* Host stand-in for libogc's processor.h. Register accesses are no-ops. */
+
+#ifndef __PROCESSOR_H__
+#define __PROCESSOR_H__
+
+#include "gctypes.h"
+
+static inline u32 read32(u32 addr) { (void)addr; return 0; }
+static inline void write32(u32 addr, u32 value) { (void)addr; (void)value; }
+static inline u16 read16(u32 addr) { (void)addr; return 0; }
+static inline void write16(u32 addr, u16 value) { (void)addr; (void)value; }
+
+#endif
@@ -0,0 +1,8 @@
+/* Host stand-in for libogc's pad.h */
+
+#ifndef __PAD_H__
+#define __PAD_H__
+
+#include "gctypes.h"
+
+#endif
@@ -0,0 +1,8 @@
+/* Host stand-in for libogc's ogcsys.h */
+
+#ifndef __OGCSYS_H__
+#define __OGCSYS_H__
+
+#include "gccore.h"
+
+#endif
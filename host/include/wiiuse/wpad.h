@@ -0,0 +1,20 @@
+/* Host stand-in for wiiuse/wpad.h, button masks only */
+
+#ifndef __WPAD_H__
+#define __WPAD_H__
+
+#include "gctypes.h"
+
+#define WPAD_BUTTON_2		0x0001
+#define WPAD_BUTTON_1		0x0002
+#define WPAD_BUTTON_B		0x0004
+#define WPAD_BUTTON_A		0x0008
+#define WPAD_BUTTON_MINUS	0x0010
+#define WPAD_BUTTON_HOME	0x0080
+#define WPAD_BUTTON_LEFT	0x0100
+#define WPAD_BUTTON_RIGHT	0x0200
+#define WPAD_BUTTON_DOWN	0x0400
+#define WPAD_BUTTON_UP		0x0800
+#define WPAD_BUTTON_PLUS	0x1000
+
+#endif
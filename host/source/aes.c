@@ -0,0 +1,62 @@
+/* Stand-in AES engine, AES-128-CBC through OpenSSL */
+
+#include <string.h>
+#include <openssl/evp.h>
+
+#include <ogc/aes.h>
+
+static s32 __AES_Crypt(const void* key, u32 key_size, void* iv, u32 iv_size, const void* in, void* out, u32 size, bool encrypt)
+{
+	u8 next[16];
+	int len = 0;
+	s32 ret = -1;
+
+	if (key_size != 16 || iv_size != 16 || (size & 15))
+		return -4;
+
+	if (!size)
+		return 0;
+
+	/* Chain on like the hardware does: the IV ends up as the last cipher block */
+	if (!encrypt)
+		memcpy(next, (const u8*)in + size - 16, 16);
+
+	EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+	if (!ctx)
+		return -22;
+
+	if (EVP_CipherInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv, encrypt) == 1 &&
+		EVP_CIPHER_CTX_set_padding(ctx, 0) == 1 &&
+		EVP_CipherUpdate(ctx, out, &len, in, size) == 1)
+		ret = 0;
+
+	EVP_CIPHER_CTX_free(ctx);
+
+	if (encrypt)
+		memcpy(next, (const u8*)out + size - 16, 16);
+
+	if (!ret)
+		memcpy(iv, next, 16);
+
+	return ret;
+}
+
+s32 AES_Init(void)
+{
+	return 0;
+}
+
+s32 AES_Close(void)
+{
+	return 0;
+}
+
+s32 AES_Encrypt(const void* key, u32 key_size, void* iv, u32 iv_size, const void* in, void* out, u32 size)
+{
+	return __AES_Crypt(key, key_size, iv, iv_size, in, out, size, true);
+}
+
+s32 AES_Decrypt(const void* key, u32 key_size, void* iv, u32 iv_size, const void* in, void* out, u32 size)
+{
+	return __AES_Crypt(key, key_size, iv, iv_size, in, out, size, false);
+}
@@ -0,0 +1,908 @@
+/*
+ * Stand-in ES.
+ *
+ * Titles, tickets and shared contents are kept in the NAND root laid out
+ * like the real NAND. Contents are decrypted with the title key and their
+ * SHA-1 checked against the TMD, like ES does, so a bad WAD fails here the
+ * same way it fails on a console.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <openssl/evp.h>
+
+#include "standin.h"
+#include "title.h"
+
+/* Constants */
+#define IMPORT_DIR	"/import"
+#define CONTENT_FD	1
+
+/* Title being imported */
+static struct
+{
+	bool active;
+	u64 tid;
+
+	signed_blob* stmd;
+	u32 stmdSize;
+	tmd* tmd;
+
+	aeskey titleKey;
+
+	/* Content being imported */
+	bool writing;
+	u32 index;
+	u64 left;
+	FILE* fp;
+	EVP_CIPHER_CTX* aes;
+	EVP_MD_CTX* sha;
+} gImport;
+
+static StandInStats gStats;
+
+/* Every ES call is timed into one of the stats buckets */
+#define TIMED(field, call) ({ \
+	u64 __start = gettime(); \
+	s32 __ret = (call); \
+	gStats.field += diff_usec(__start, gettime()); \
+	__ret; })
+
+static u8* __ES_LoadFile(const char* nandPath, u32* size)
+{
+	char path[PATH_MAX];
+
+	if (StandIn_Path(nandPath, path, sizeof(path)) < 0)
+		return NULL;
+
+	FILE* fp = fopen(path, "rb");
+	if (!fp)
+		return NULL;
+
+	fseek(fp, 0, SEEK_END);
+	long len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	u8* data = malloc(len ? len : 1);
+	if (data && fread(data, 1, len, fp) != (size_t)len)
+	{
+		free(data);
+		data = NULL;
+	}
+
+	fclose(fp);
+
+	if (data && size)
+		*size = len;
+
+	return data;
+}
+
+static s32 __ES_SaveFile(const char* nandPath, const void* data, u32 size)
+{
+	char path[PATH_MAX];
+
+	if (StandIn_Path(nandPath, path, sizeof(path)) < 0)
+		return ES_EINVAL;
+
+	FILE* fp = fopen(path, "wb");
+	if (!fp)
+		return STANDIN_ENOENT;
+
+	size_t written = fwrite(data, 1, size, fp);
+	fclose(fp);
+
+	return (written == size) ? 0 : -1;
+}
+
+static bool __ES_Exists(const char* nandPath)
+{
+	char path[PATH_MAX];
+	struct stat st;
+
+	if (StandIn_Path(nandPath, path, sizeof(path)) < 0)
+		return false;
+
+	return !stat(path, &st);
+}
+
+static void __ES_BE64(u8* out, u64 value)
+{
+	for (int i = 0; i < 8; i++)
+		out[i] = value >> (56 - i * 8);
+}
+
+static void __ES_TitlePath(char* out, u64 tid, const char* file)
+{
+	sprintf(out, "/title/%08x/%08x/%s", (u32)(tid >> 32), (u32)tid, file);
+}
+
+static void __ES_TicketPath(char* out, u64 tid)
+{
+	sprintf(out, "/ticket/%08x/%08x.tik", (u32)(tid >> 32), (u32)tid);
+}
+
+static signed_blob* __ES_LoadTMD(u64 tid, u32* size)
+{
+	char path[ISFS_MAXPATH * 2];
+
+	__ES_TitlePath(path, tid, "content/title.tmd");
+	return (signed_blob*)__ES_LoadFile(path, size);
+}
+
+static s32 __ES_CryptBlock(const u8* key, u8* iv, const u8* in, u8* out, u32 size, bool encrypt)
+{
+	EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+	int len = 0;
+	s32 ret = -1;
+
+	if (!ctx)
+		return -1;
+
+	if (EVP_CipherInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv, encrypt) == 1 &&
+		EVP_CIPHER_CTX_set_padding(ctx, 0) == 1 &&
+		EVP_CipherUpdate(ctx, out, &len, in, size) == 1)
+		ret = 0;
+
+	EVP_CIPHER_CTX_free(ctx);
+	return ret;
+}
+
+static s32 __ES_GetTitleKey(const signed_blob* s_tik, aeskey key)
+{
+	const tik* p_tik = SIGNATURE_PAYLOAD(s_tik);
+	u8 iv[16] = {};
+
+	__ES_BE64(iv, p_tik->titleid);
+	memcpy(key, p_tik->cipher_title_key, sizeof(aeskey));
+
+	return __ES_CryptBlock(StandIn_GetCommonKey(), iv, key, key, sizeof(aeskey), false);
+}
+
+static void __ES_ResetContent(void)
+{
+	if (gImport.fp)
+		fclose(gImport.fp);
+
+	EVP_CIPHER_CTX_free(gImport.aes);
+	EVP_MD_CTX_free(gImport.sha);
+
+	gImport.fp = NULL;
+	gImport.aes = NULL;
+	gImport.sha = NULL;
+	gImport.writing = false;
+}
+
+static void __ES_ResetImport(void)
+{
+	__ES_ResetContent();
+
+	free(gImport.stmd);
+	memset(&gImport, 0, sizeof(gImport));
+
+	StandIn_Remove(IMPORT_DIR);
+}
+
+s32 __ES_Init(void)
+{
+	return 0;
+}
+
+s32 __ES_Close(void)
+{
+	return 0;
+}
+
+s32 ES_GetTitleID(u64* titleID)
+{
+	/* We are running as the HBC */
+	*titleID = 0x000100014F484243ULL;
+	return 0;
+}
+
+static s32 __ES_GetDataDir(u64 titleID, char* filepath)
+{
+	char path[ISFS_MAXPATH * 2];
+
+	__ES_TitlePath(path, titleID, "content/title.tmd");
+	if (!__ES_Exists(path))
+		return STANDIN_ENOENT;
+
+	__ES_TitlePath(filepath, titleID, "data");
+	return 0;
+}
+
+static s32 __ES_ListTitles(u64* titles, u32 max)
+{
+	char path[PATH_MAX];
+	u32 cnt = 0;
+
+	StandIn_Path("/title", path, sizeof(path));
+
+	DIR* upper = opendir(path);
+	if (!upper)
+		return 0;
+
+	struct dirent* ent;
+	while ((ent = readdir(upper)) != NULL)
+	{
+		char sub[PATH_MAX];
+		u32 hi, lo;
+
+		if (sscanf(ent->d_name, "%8x", &hi) != 1 || strlen(ent->d_name) != 8)
+			continue;
+
+		snprintf(sub, sizeof(sub), "%s/%s", path, ent->d_name);
+
+		DIR* lower = opendir(sub);
+		if (!lower)
+			continue;
+
+		struct dirent* ent2;
+		while ((ent2 = readdir(lower)) != NULL)
+		{
+			char tmdPath[ISFS_MAXPATH * 2];
+
+			if (sscanf(ent2->d_name, "%8x", &lo) != 1 || strlen(ent2->d_name) != 8)
+				continue;
+
+			__ES_TitlePath(tmdPath, ((u64)hi << 32) | lo, "content/title.tmd");
+			if (!__ES_Exists(tmdPath))
+				continue;
+
+			if (titles && cnt < max)
+				titles[cnt] = ((u64)hi << 32) | lo;
+
+			cnt++;
+		}
+
+		closedir(lower);
+	}
+
+	closedir(upper);
+	return cnt;
+}
+
+s32 ES_GetNumTitles(u32* cnt)
+{
+	*cnt = __ES_ListTitles(NULL, 0);
+	return 0;
+}
+
+s32 ES_GetTitles(u64* titles, u32 cnt)
+{
+	__ES_ListTitles(titles, cnt);
+	return 0;
+}
+
+s32 ES_GetDeviceID(u32* device_id)
+{
+	*device_id = 0x0403AC68;
+	return 0;
+}
+
+s32 ES_GetBoot2Version(u32* version)
+{
+	*version = 4;
+	return 0;
+}
+
+static s32 __ES_GetStoredTMDSize(u64 titleID, u32* size)
+{
+	signed_blob* stmd = __ES_LoadTMD(titleID, size);
+	if (!stmd)
+		return STANDIN_ENOENT;
+
+	free(stmd);
+	return 0;
+}
+
+static s32 __ES_GetStoredTMD(u64 titleID, signed_blob* stmd, u32 size)
+{
+	u32 len = 0;
+	signed_blob* data = __ES_LoadTMD(titleID, &len);
+	if (!data)
+		return STANDIN_ENOENT;
+
+	if (size < len)
+	{
+		free(data);
+		return ES_EINVAL;
+	}
+
+	memcpy(stmd, data, len);
+	free(data);
+
+	return 0;
+}
+
+/* Contents of the stored TMD that are on the NAND, private or shared */
+static s32 __ES_GetStoredContents(u64 titleID, u32* contents, u32* cnt, u32 max)
+{
+	char path[ISFS_MAXPATH * 2];
+	u32 size = 0, found = 0;
+
+	signed_blob* stmd = __ES_LoadTMD(titleID, NULL);
+	if (!stmd)
+		return STANDIN_ENOENT;
+
+	tmd* p_tmd = SIGNATURE_PAYLOAD(stmd);
+
+	SharedContent* map = (SharedContent*)__ES_LoadFile("/shared1/content.map", &size);
+	u32 shared = map ? size / sizeof(SharedContent) : 0;
+
+	for (u32 i = 0; i < p_tmd->num_contents; i++)
+	{
+		tmd_content* content = &p_tmd->contents[i];
+		bool present = false;
+
+		if (content->type & 0x8000)
+		{
+			for (u32 j = 0; j < shared && !present; j++)
+			{
+				if (memcmp(map[j].hash, content->hash, sizeof(sha1)))
+					continue;
+
+				sprintf(path, "/shared1/%.8s.app", map[j].filename);
+				present = __ES_Exists(path);
+			}
+		}
+		else
+		{
+			__ES_TitlePath(path, titleID, "content");
+			sprintf(path + strlen(path), "/%08x.app", content->cid);
+			present = __ES_Exists(path);
+		}
+
+		if (!present)
+			continue;
+
+		if (contents && found < max)
+			contents[found] = content->cid;
+
+		found++;
+	}
+
+	free(map);
+	free(stmd);
+
+	*cnt = found;
+	return 0;
+}
+
+static s32 __ES_GetTMDViewSize(u64 titleID, u32* size)
+{
+	signed_blob* stmd = __ES_LoadTMD(titleID, NULL);
+	if (!stmd)
+		return STANDIN_ENOENT;
+
+	tmd* p_tmd = SIGNATURE_PAYLOAD(stmd);
+	*size = sizeof(tmd_view) + p_tmd->num_contents * sizeof(tmd_view_content);
+
+	free(stmd);
+	return 0;
+}
+
+static s32 __ES_GetTMDView(u64 titleID, u8* data, u32 size)
+{
+	signed_blob* stmd = __ES_LoadTMD(titleID, NULL);
+	if (!stmd)
+		return STANDIN_ENOENT;
+
+	tmd* p_tmd = SIGNATURE_PAYLOAD(stmd);
+	tmd_view* view = (tmd_view*)data;
+
+	if (size < sizeof(tmd_view) + p_tmd->num_contents * sizeof(tmd_view_content))
+	{
+		free(stmd);
+		return ES_EINVAL;
+	}
+
+	memset(view, 0, size);
+	view->version       = p_tmd->version;
+	view->sys_version   = p_tmd->sys_version;
+	view->title_id      = p_tmd->title_id;
+	view->title_type    = p_tmd->title_type;
+	view->group_id      = p_tmd->group_id;
+	view->title_version = p_tmd->title_version;
+	view->num_contents  = p_tmd->num_contents;
+
+	for (u32 i = 0; i < p_tmd->num_contents; i++)
+	{
+		view->contents[i].cid   = p_tmd->contents[i].cid;
+		view->contents[i].index = p_tmd->contents[i].index;
+		view->contents[i].type  = p_tmd->contents[i].type;
+		view->contents[i].size  = p_tmd->contents[i].size;
+	}
+
+	free(stmd);
+	return 0;
+}
+
+static s32 __ES_GetNumTicketViews(u64 titleID, u32* cnt)
+{
+	char path[ISFS_MAXPATH * 2];
+
+	__ES_TicketPath(path, titleID);
+	*cnt = __ES_Exists(path) ? 1 : 0;
+
+	return 0;
+}
+
+static s32 __ES_GetTicketViews(u64 titleID, tikview* views, u32 cnt)
+{
+	char path[ISFS_MAXPATH * 2];
+
+	if (!cnt)
+		return ES_EINVAL;
+
+	__ES_TicketPath(path, titleID);
+
+	signed_blob* s_tik = (signed_blob*)__ES_LoadFile(path, NULL);
+	if (!s_tik)
+		return STANDIN_ENOENT;
+
+	tik* p_tik = SIGNATURE_PAYLOAD(s_tik);
+
+	memset(views, 0, sizeof(tikview));
+	views->ticketid    = p_tik->ticketid;
+	views->devicetype  = p_tik->devicetype;
+	views->titleid     = p_tik->titleid;
+	views->access_mask = p_tik->access_mask;
+	memcpy(views->cidx_mask, p_tik->cidx_mask, sizeof(views->cidx_mask));
+	memcpy(views->limits, p_tik->limits, sizeof(views->limits));
+
+	free(s_tik);
+	return 0;
+}
+
+static s32 __ES_AddTicket(const signed_blob* s_tik, u32 tik_size, __attribute__((unused)) const signed_blob* certificates, __attribute__((unused)) u32 certificates_size, __attribute__((unused)) const signed_blob* crl, __attribute__((unused)) u32 crl_size)
+{
+	char path[ISFS_MAXPATH * 2];
+	const tik* p_tik = SIGNATURE_PAYLOAD(s_tik);
+
+	if (!SIGNATURE_SIZE(s_tik) || tik_size < SIGNATURE_SIZE(s_tik) + sizeof(tik))
+		return ES_EINVAL;
+
+	sprintf(path, "/ticket/%08x", (u32)(p_tik->titleid >> 32));
+	StandIn_MakePath(path);
+
+	__ES_TicketPath(path, p_tik->titleid);
+	return __ES_SaveFile(path, s_tik, tik_size);
+}
+
+static s32 __ES_AddTitleStart(const signed_blob* stmd, u32 tmd_size, __attribute__((unused)) const signed_blob* certificates, __attribute__((unused)) u32 certificates_size, __attribute__((unused)) const signed_blob* crl, __attribute__((unused)) u32 crl_size)
+{
+	char path[ISFS_MAXPATH * 2];
+
+	if (!SIGNATURE_SIZE(stmd) || tmd_size < SIGNATURE_SIZE(stmd) + sizeof(tmd))
+		return ES_EINVAL;
+
+	/* A new import drops whatever was left over */
+	__ES_ResetImport();
+
+	gImport.stmd = malloc(tmd_size);
+	if (!gImport.stmd)
+		return ES_ENOMEM;
+
+	memcpy(gImport.stmd, stmd, tmd_size);
+	gImport.stmdSize = tmd_size;
+	gImport.tmd = SIGNATURE_PAYLOAD(gImport.stmd);
+	gImport.tid = gImport.tmd->title_id;
+
+	if (tmd_size < SIGNATURE_SIZE(stmd) + TMD_SIZE(gImport.tmd))
+	{
+		__ES_ResetImport();
+		return ES_EINVAL;
+	}
+
+	/* The ticket has to be there already */
+	__ES_TicketPath(path, gImport.tid);
+
+	signed_blob* s_tik = (signed_blob*)__ES_LoadFile(path, NULL);
+	if (!s_tik)
+	{
+		__ES_ResetImport();
+		return STANDIN_ENOENT;
+	}
+
+	s32 ret = __ES_GetTitleKey(s_tik, gImport.titleKey);
+	free(s_tik);
+
+	if (ret < 0)
+	{
+		__ES_ResetImport();
+		return ret;
+	}
+
+	StandIn_MakePath(IMPORT_DIR);
+	gImport.active = true;
+
+	return 0;
+}
+
+static s32 __ES_AddContentStart(u64 titleID, u32 cid)
+{
+	char path[ISFS_MAXPATH * 2];
+	char hostPath[PATH_MAX];
+	u8 iv[16] = {};
+	u32 i;
+
+	if (!gImport.active || gImport.writing || titleID != gImport.tid)
+		return ES_EINVAL;
+
+	for (i = 0; i < gImport.tmd->num_contents; i++)
+	{
+		if (gImport.tmd->contents[i].cid == cid)
+			break;
+	}
+
+	if (i == gImport.tmd->num_contents)
+		return ES_EINVAL;
+
+	tmd_content* content = &gImport.tmd->contents[i];
+
+	sprintf(path, IMPORT_DIR "/%08x.app", cid);
+	StandIn_Path(path, hostPath, sizeof(hostPath));
+
+	gImport.fp  = fopen(hostPath, "wb");
+	gImport.aes = EVP_CIPHER_CTX_new();
+	gImport.sha = EVP_MD_CTX_new();
+
+	if (!gImport.fp || !gImport.aes || !gImport.sha)
+	{
+		__ES_ResetContent();
+		return ES_ENOMEM;
+	}
+
+	/* Contents are encrypted with their index as IV */
+	iv[0] = content->index >> 8;
+	iv[1] = content->index;
+
+	EVP_DecryptInit_ex(gImport.aes, EVP_aes_128_cbc(), NULL, gImport.titleKey, iv);
+	EVP_CIPHER_CTX_set_padding(gImport.aes, 0);
+	EVP_DigestInit_ex(gImport.sha, EVP_sha1(), NULL);
+
+	gImport.writing = true;
+	gImport.index = i;
+	gImport.left  = content->size;
+
+	return CONTENT_FD;
+}
+
+static s32 __ES_AddContentData(s32 cid, u8* data, u32 data_size)
+{
+	static u8 plain[0x10000];
+
+	if (!gImport.writing || cid != CONTENT_FD || (data_size & 15))
+		return ES_EINVAL;
+
+	while (data_size)
+	{
+		u32 size = data_size > sizeof(plain) ? sizeof(plain) : data_size;
+		int len = 0;
+
+		EVP_DecryptUpdate(gImport.aes, plain, &len, data, size);
+
+		/* Padding past the end of the content is not part of it */
+		u32 keep = (gImport.left < (u64)len) ? (u32)gImport.left : (u32)len;
+
+		EVP_DigestUpdate(gImport.sha, plain, keep);
+		if (fwrite(plain, 1, keep, gImport.fp) != keep)
+			return -1;
+
+		gImport.left -= keep;
+		gStats.contentBytes += size;
+		data += size;
+		data_size -= size;
+	}
+
+	return 0;
+}
+
+static s32 __ES_AddSharedContent(const char* src, const tmd_content* content)
+{
+	char path[ISFS_MAXPATH * 2];
+	u32 size = 0;
+	s32 ret;
+
+	StandIn_MakePath("/shared1");
+
+	SharedContent* map = (SharedContent*)__ES_LoadFile("/shared1/content.map", &size);
+	u32 count = size / sizeof(SharedContent);
+
+	for (u32 i = 0; i < count; i++)
+	{
+		if (!memcmp(map[i].hash, content->hash, sizeof(sha1)))
+		{
+			/* Someone else already installed it */
+			free(map);
+			return StandIn_Remove(src);
+		}
+	}
+
+	map = realloc(map, (count + 1) * sizeof(SharedContent));
+	if (!map)
+		return ES_ENOMEM;
+
+	char name[9];
+	sprintf(name, "%08x", count);
+	memcpy(map[count].filename, name, sizeof(map[count].filename));
+	memcpy(map[count].hash, content->hash, sizeof(sha1));
+
+	sprintf(path, "/shared1/%08x.app", count);
+	ret = ISFS_Rename(src, path);
+	if (ret < 0)
+		goto out;
+
+	ret = __ES_SaveFile("/shared1/content.map", map, (count + 1) * sizeof(SharedContent));
+
+out:
+	free(map);
+	return ret;
+}
+
+static s32 __ES_AddContentFinish(u32 cid)
+{
+	char path[ISFS_MAXPATH * 2];
+	u8 hash[EVP_MAX_MD_SIZE];
+	unsigned int hashLen = 0;
+	s32 ret = 0;
+
+	if (!gImport.writing || cid != CONTENT_FD)
+		return ES_EINVAL;
+
+	tmd_content* content = &gImport.tmd->contents[gImport.index];
+	EVP_DigestFinal_ex(gImport.sha, hash, &hashLen);
+
+	bool complete = (gImport.left == 0);
+	__ES_ResetContent();
+
+	sprintf(path, IMPORT_DIR "/%08x.app", content->cid);
+
+	if (!complete)
+		ret = ES_EINVAL;
+	else if (memcmp(hash, content->hash, sizeof(sha1)))
+		ret = STANDIN_EHASH;
+	else if (content->type & 0x8000)
+		ret = __ES_AddSharedContent(path, content);
+
+	if (ret < 0)
+		StandIn_Remove(path);
+	else
+		gStats.contents++;
+
+	return ret;
+}
+
+static s32 __ES_AddTitleFinish(void)
+{
+	char path[ISFS_MAXPATH * 2];
+	char dst[ISFS_MAXPATH * 2];
+	s32 ret;
+
+	if (!gImport.active || gImport.writing)
+		return ES_EINVAL;
+
+	__ES_TitlePath(path, gImport.tid, "content");
+	StandIn_MakePath(path);
+	__ES_TitlePath(path, gImport.tid, "data");
+	StandIn_MakePath(path);
+
+	/* Replace the old contents with the imported ones */
+	for (u32 i = 0; i < gImport.tmd->num_contents; i++)
+	{
+		tmd_content* content = &gImport.tmd->contents[i];
+
+		if (content->type & 0x8000)
+			continue;
+
+		sprintf(path, IMPORT_DIR "/%08x.app", content->cid);
+		if (!__ES_Exists(path))
+			continue;
+
+		sprintf(dst, "/title/%08x/%08x/content/%08x.app", (u32)(gImport.tid >> 32), (u32)gImport.tid, content->cid);
+		ret = ISFS_Rename(path, dst);
+		if (ret < 0)
+			goto out;
+	}
+
+	__ES_TitlePath(path, gImport.tid, "content/title.tmd");
+	ret = __ES_SaveFile(path, gImport.stmd, gImport.stmdSize);
+
+out:
+	__ES_ResetImport();
+	return ret;
+}
+
+s32 ES_AddTitleCancel(void)
+{
+	__ES_ResetImport();
+	return 0;
+}
+
+static s32 __ES_DeleteTitle(u64 titleID)
+{
+	char path[ISFS_MAXPATH * 2];
+
+	sprintf(path, "/title/%08x/%08x", (u32)(titleID >> 32), (u32)titleID);
+	return StandIn_Remove(path);
+}
+
+static s32 __ES_DeleteTitleContent(u64 titleID)
+{
+	char path[ISFS_MAXPATH * 2];
+	char hostPath[PATH_MAX];
+
+	__ES_TitlePath(path, titleID, "content");
+	StandIn_Path(path, hostPath, sizeof(hostPath));
+
+	DIR* dir = opendir(hostPath);
+	if (!dir)
+		return STANDIN_ENOENT;
+
+	struct dirent* ent;
+	while ((ent = readdir(dir)) != NULL)
+	{
+		if (ent->d_name[0] == '.')
+			continue;
+
+		char file[PATH_MAX];
+		snprintf(file, sizeof(file), "%s/%s", hostPath, ent->d_name);
+		unlink(file);
+	}
+
+	closedir(dir);
+	return 0;
+}
+
+static s32 __ES_DeleteTicket(const tikview* view)
+{
+	char path[ISFS_MAXPATH * 2];
+
+	__ES_TicketPath(path, view->titleid);
+	return StandIn_Remove(path);
+}
+
+/*
+ * Gives the NAND a System Menu: a TMD without contents and the console's
+ * setting.txt, which is enough for the region and IOS safety checks.
+ */
+s32 StandIn_SeedSystem(u16 smVersion, u32 smIOS, const char* area)
+{
+	static u8 stmd[sizeof(sig_rsa2048) + sizeof(tmd)];
+	char setting[0x100] = {};
+	u32 key = 0x73B5DBFA;
+	s32 ret;
+
+	memset(stmd, 0, sizeof(stmd));
+	((sig_rsa2048*)stmd)->type = ES_SIG_RSA2048;
+
+	tmd* p_tmd = SIGNATURE_PAYLOAD((signed_blob*)stmd);
+	p_tmd->sys_version   = 0x100000000ULL | smIOS;
+	p_tmd->title_id      = 0x100000002ULL;
+	p_tmd->title_version = smVersion;
+
+	StandIn_MakePath("/title/00000001/00000002/content");
+	StandIn_MakePath("/title/00000001/00000002/data");
+
+	ret = __ES_SaveFile("/title/00000001/00000002/content/title.tmd", stmd, sizeof(stmd));
+	if (ret < 0)
+		return ret;
+
+	/* setting.txt is scrambled with a rolling XOR key */
+	snprintf(setting, sizeof(setting), "AREA=%s\r\nMODEL=RVL-001(%s)\r\nDVD=0\r\nMPCH=0x7FFE\r\n", area, area);
+
+	for (u32 i = 0; i < sizeof(setting); i++)
+	{
+		setting[i] ^= key & 0xFF;
+		key = (key << 1) | (key >> 31);
+	}
+
+	return __ES_SaveFile("/title/00000001/00000002/data/setting.txt", setting, sizeof(setting));
+}
+
+void StandIn_GetStats(StandInStats* out)
+{
+	*out = gStats;
+}
+
+void StandIn_ResetStats(void)
+{
+	memset(&gStats, 0, sizeof(gStats));
+}
+
+s32 ES_GetDataDir(u64 titleID, char* filepath)
+{
+	return TIMED(lookupTime, __ES_GetDataDir(titleID, filepath));
+}
+
+s32 ES_GetStoredTMDSize(u64 titleID, u32* size)
+{
+	return TIMED(lookupTime, __ES_GetStoredTMDSize(titleID, size));
+}
+
+s32 ES_GetStoredTMD(u64 titleID, signed_blob* stmd, u32 size)
+{
+	return TIMED(lookupTime, __ES_GetStoredTMD(titleID, stmd, size));
+}
+
+s32 ES_GetStoredContentCnt(u64 titleID, u32* cnt)
+{
+	return TIMED(lookupTime, __ES_GetStoredContents(titleID, NULL, cnt, 0));
+}
+
+s32 ES_GetStoredContents(u64 titleID, u32* contents, u32 cnt)
+{
+	u32 found;
+	return TIMED(lookupTime, __ES_GetStoredContents(titleID, contents, &found, cnt));
+}
+
+s32 ES_GetTMDViewSize(u64 titleID, u32* size)
+{
+	return TIMED(lookupTime, __ES_GetTMDViewSize(titleID, size));
+}
+
+s32 ES_GetTMDView(u64 titleID, u8* data, u32 size)
+{
+	return TIMED(lookupTime, __ES_GetTMDView(titleID, data, size));
+}
+
+s32 ES_GetNumTicketViews(u64 titleID, u32* cnt)
+{
+	return TIMED(lookupTime, __ES_GetNumTicketViews(titleID, cnt));
+}
+
+s32 ES_GetTicketViews(u64 titleID, tikview* views, u32 cnt)
+{
+	return TIMED(lookupTime, __ES_GetTicketViews(titleID, views, cnt));
+}
+
+s32 ES_AddTicket(const signed_blob* s_tik, u32 tik_size, const signed_blob* certificates, u32 certificates_size, const signed_blob* crl, u32 crl_size)
+{
+	return TIMED(ticketTime, __ES_AddTicket(s_tik, tik_size, certificates, certificates_size, crl, crl_size));
+}
+
+s32 ES_AddTitleStart(const signed_blob* stmd, u32 tmd_size, const signed_blob* certificates, u32 certificates_size, const signed_blob* crl, u32 crl_size)
+{
+	return TIMED(titleStartTime, __ES_AddTitleStart(stmd, tmd_size, certificates, certificates_size, crl, crl_size));
+}
+
+s32 ES_AddContentStart(u64 titleID, u32 cid)
+{
+	return TIMED(contentTime, __ES_AddContentStart(titleID, cid));
+}
+
+s32 ES_AddContentData(s32 cid, u8* data, u32 data_size)
+{
+	return TIMED(contentTime, __ES_AddContentData(cid, data, data_size));
+}
+
+s32 ES_AddContentFinish(u32 cid)
+{
+	return TIMED(contentTime, __ES_AddContentFinish(cid));
+}
+
+s32 ES_AddTitleFinish(void)
+{
+	return TIMED(titleFinishTime, __ES_AddTitleFinish());
+}
+
+s32 ES_DeleteTitle(u64 titleID)
+{
+	return TIMED(deleteTime, __ES_DeleteTitle(titleID));
+}
+
+s32 ES_DeleteTitleContent(u64 titleID)
+{
+	return TIMED(deleteTime, __ES_DeleteTitleContent(titleID));
+}
+
+s32 ES_DeleteTicket(const tikview* view)
+{
+	return TIMED(deleteTime, __ES_DeleteTicket(view));
+}
@@ -0,0 +1,503 @@
+/*
+ * iosscan - checks and benchmarks the IOS patch signature scan.
+ *
+ *   iosscan [-r runs] [-c cache] [-g golden [-u]] [-v] [image...]
+ *
+ * Every image is a dump of IOS memory, scanned for all patch sets with the
+ * single-pass scanner and with a plain memcmp at every byte, one signature
+ * at a time, which is what IOSPATCH_Apply used to do. Both have to find
+ * the same signatures at the same offsets, and patching a copy of the
+ * image has to give the same bytes both ways. Without images two synthetic
+ * 12 MiB images with known signatures are used. -v prints every match.
+ *
+ * -c checks the patch location cache with a fresh cache file: the first
+ * boot has to scan, the next one has to patch from the cache alone, and
+ * one whose memory no longer matches the cache has to scan again.
+ *
+ * -g compares what was found and patched in each image with its golden
+ * output, golden/<image name>.golden: the matches of every signature, the
+ * bytes patched and the SHA-1 of the patched image. -u writes them instead,
+ * after a change that is meant to find or patch something else. Images
+ * recorded on the console with RecordIOS=1 are named after the IOS and its
+ * revision, ios58-6176.bin has golden/ios58-6176.golden.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <gccore.h>
+#include "sha1.h"
+#include "iospatch.h"
+#include "patchscan.h"
+#include "patchcache.h"
+
+/* Constants */
+#define SYNTH_SIZE	(12 << 20)
+#define ALL_SETS	(IOSPATCH_SET_ES | IOSPATCH_SET_VWII | IOSPATCH_SET_AHBPROT)
+
+static bool gVerbose = false;
+static const char* gCache = NULL;
+static const char* gGolden = NULL;
+static bool gUpdate = false;
+
+static u64 __Now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* One signature at a time, every byte */
+static u32 __Reference(const u8* mem, u32 size, const IOSPatch* patches, u32 count, PatchScanHits* hits)
+{
+	u32 found = 0;
+
+	memset(hits, 0, count * sizeof(PatchScanHits));
+
+	for (u32 i = 0; i < count; i++)
+	{
+		for (u32 pos = 0; pos + patches[i].oldSize <= size; pos++)
+		{
+			if (memcmp(mem + pos, patches[i].old, patches[i].oldSize))
+				continue;
+
+			if (hits[i].hits < PATCHSCAN_MAX_OFFSETS)
+				hits[i].offsets[hits[i].hits] = pos;
+
+			hits[i].hits++;
+			found++;
+		}
+	}
+
+	return found;
+}
+
+/* The old apply_patch, one signature after the other over the memory as
+ * the previous ones left it */
+static u32 __ReferencePatch(u8* mem, u32 size, const IOSPatch* patches, u32 count)
+{
+	u32 written = 0;
+
+	for (u32 i = 0; i < count; i++)
+	{
+		const IOSPatch* patch = &patches[i];
+
+		for (u32 pos = 0; pos + patch->oldSize <= size; pos++)
+		{
+			if (memcmp(mem + pos, patch->old, patch->oldSize) || pos + patch->patchOffset + patch->patchSize > size)
+				continue;
+
+			memcpy(mem + pos + patch->patchOffset, patch->patch, patch->patchSize);
+			written += patch->patchSize;
+		}
+	}
+
+	return written;
+}
+
+/* Random bytes with every signature planted, at odd offsets and at the
+ * very end. A crowded one has one more often than the scan keeps offsets
+ * for, back to back. */
+static u8* __Synthesize(u32* size, bool crowded)
+{
+	u32 count;
+	const IOSPatch* patches = IOSPATCH_GetPatches(&count);
+
+	u8* mem = malloc(SYNTH_SIZE);
+	if (!mem)
+		return NULL;
+
+	/* Same bytes with every libc, the golden outputs depend on them */
+	u32 seed = 1;
+	for (u32 i = 0; i < SYNTH_SIZE; i++)
+	{
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		mem[i] = seed >> 24;
+	}
+
+	u32 pos = 0x1000;
+	for (u32 i = 0; i < count; i++)
+	{
+		for (u32 j = 0; j < 2; j++)
+		{
+			memcpy(mem + pos + j, patches[i].old, patches[i].oldSize);
+			pos += 0x9000 + patches[i].oldSize + j;
+		}
+	}
+
+	for (u32 i = 0; crowded && i < PATCHSCAN_MAX_OFFSETS + 4; i++)
+		memcpy(mem + 0x400000 + i * patches[0].oldSize, patches[0].old, patches[0].oldSize);
+
+	memcpy(mem + SYNTH_SIZE - patches[1].oldSize, patches[1].old, patches[1].oldSize);
+
+	*size = SYNTH_SIZE;
+	return mem;
+}
+
+static u8* __Load(const char* path, u32* size)
+{
+	FILE* fp = fopen(path, "rb");
+	if (!fp)
+		return NULL;
+
+	fseek(fp, 0, SEEK_END);
+	long len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	u8* mem = (len > 0) ? malloc(len) : NULL;
+	if (mem && fread(mem, 1, len, fp) != (size_t)len)
+	{
+		free(mem);
+		mem = NULL;
+	}
+
+	fclose(fp);
+
+	*size = len;
+	return mem;
+}
+
+/* What the golden output records: everything but the times */
+static char* __Report(const u8* patched, u32 size, const PatchScanHits* hits, s32 found, u32 bytes)
+{
+	u32 count;
+	const IOSPatch* patches = IOSPATCH_GetPatches(&count);
+
+	char* report = NULL;
+	size_t len;
+	u8 hash[20];
+
+	FILE* fp = open_memstream(&report, &len);
+	if (!fp)
+		return NULL;
+
+	fprintf(fp, "size %u\nmatches %d\n", size, found);
+
+	for (u32 i = 0; i < count; i++)
+	{
+		fprintf(fp, "patch %s %u", patches[i].name, hits[i].hits);
+		for (u32 j = 0; j < hits[i].hits && j < PATCHSCAN_MAX_OFFSETS; j++)
+			fprintf(fp, " %08x", hits[i].offsets[j]);
+		fprintf(fp, "\n");
+	}
+
+	SHA1((u8*)patched, size, hash);
+
+	fprintf(fp, "bytes %u\nsha1 ", bytes);
+	for (u32 i = 0; i < sizeof(hash); i++)
+		fprintf(fp, "%02x", hash[i]);
+	fprintf(fp, "\n");
+
+	fclose(fp);
+	return report;
+}
+
+/* Image name without its folder and extension */
+static void __GoldenPath(const char* name, char* path, size_t size)
+{
+	const char* base = strrchr(name, '/');
+	base = base ? base + 1 : name;
+
+	const char* ext = strrchr(base, '.');
+	int len = ext ? (int)(ext - base) : (int)strlen(base);
+
+	snprintf(path, size, "%s/%.*s.golden", gGolden, len, base);
+}
+
+static int __Golden(const char* name, const char* report)
+{
+	char path[512], line[512];
+	int failed = 0, number = 0;
+
+	__GoldenPath(name, path, sizeof(path));
+
+	if (gUpdate)
+	{
+		FILE* fp = fopen(path, "w");
+		if (!fp || fputs(report, fp) < 0)
+		{
+			fprintf(stderr, "%s: can't write\n", path);
+			failed++;
+		}
+
+		if (fp)
+			fclose(fp);
+
+		if (!failed)
+			printf("%s: golden output written to %s\n", name, path);
+
+		return failed;
+	}
+
+	FILE* fp = fopen(path, "r");
+	if (!fp)
+	{
+		printf("%s: no golden output in %s\n", name, path);
+		return 1;
+	}
+
+	/* Line by line, the first difference is enough to go on */
+	const char* pos = report;
+
+	while (!failed)
+	{
+		bool more = fgets(line, sizeof(line), fp) != NULL;
+		const char* end = strchr(pos, '\n');
+		number++;
+
+		if (!more && !*pos)
+			break;
+
+		size_t len = end ? (size_t)(end - pos + 1) : strlen(pos);
+
+		if (!more || strlen(line) != len || strncmp(line, pos, len))
+		{
+			printf("%s: differs from %s at line %d\n", name, path, number);
+			printf("  expected: %s", more ? line : "(end)\n");
+			printf("  found:    %.*s%s", (int)len, pos, len ? "" : "(end)\n");
+			failed++;
+		}
+
+		pos += len;
+	}
+
+	fclose(fp);
+
+	if (!failed)
+		printf("%s: matches %s\n", name, path);
+
+	return failed;
+}
+
+/* One boot against the cache, checked against the old apply_patch */
+static int __Boot(const char* name, const char* boot, const u8* mem, u32 size, bool expectCached)
+{
+	u32 count;
+	const IOSPatch* patches = IOSPATCH_GetPatches(&count);
+
+	u8* patched = malloc(size);
+	u8* expected = malloc(size);
+	u32 bytes = 0, expectedBytes;
+	bool cached;
+	int failed = 0;
+
+	if (!patched || !expected)
+	{
+		free(patched);
+		free(expected);
+		return 1;
+	}
+
+	memcpy(patched, mem, size);
+	memcpy(expected, mem, size);
+
+	u64 start = __Now();
+	IOSPATCH_ApplyCached(patched, size, ALL_SETS, 58, 6176, &bytes, &cached);
+	u64 usec = __Now() - start;
+
+	expectedBytes = __ReferencePatch(expected, size, patches, count);
+
+	if (cached != expectCached || bytes != expectedBytes || memcmp(patched, expected, size))
+	{
+		printf("%s: %s boot %s, patched %u bytes, expected %s and %u\n", name, boot,
+			cached ? "cached" : "scanned", bytes, expectCached ? "cached" : "scanned", expectedBytes);
+		failed++;
+	}
+
+	printf("%s: %s boot %s, %.2f ms\n", name, boot, cached ? "from the cache" : "scanned", usec / 1000.0);
+
+	free(patched);
+	free(expected);
+
+	return failed;
+}
+
+static int __CacheCheck(const char* name, const u8* mem, u32 size)
+{
+	u32 count;
+	const IOSPatch* patches = IOSPATCH_GetPatches(&count);
+	PatchScanHits hits[count];
+	int failed = 0;
+
+	remove(gCache);
+	PatchCache_SetPath(gCache);
+
+	/* Nothing to cache without a match, or with more than fits */
+	s32 found = PatchScan_Find(mem, size, patches, count, ALL_SETS, hits);
+	bool cacheable = found > 0 && found <= PATCHCACHE_MAX_HITS;
+
+	for (u32 i = 0; i < count; i++)
+		cacheable = cacheable && hits[i].hits <= PATCHSCAN_MAX_OFFSETS;
+
+	failed += __Boot(name, "first", mem, size, false);
+	failed += __Boot(name, "second", mem, size, cacheable);
+
+	if (!cacheable)
+		return failed;
+
+	/* A signature gone from where the cache has it */
+	u8* changed = malloc(size);
+	if (!changed)
+		return failed + 1;
+
+	memcpy(changed, mem, size);
+
+	for (u32 i = 0; i < count; i++)
+	{
+		if (hits[i].hits)
+		{
+			changed[hits[i].offsets[0]] ^= 0xFF;
+			break;
+		}
+	}
+
+	failed += __Boot(name, "changed", changed, size, false);
+	free(changed);
+
+	return failed;
+}
+
+static int __Scan(const char* name, const u8* mem, u32 size, u32 runs)
+{
+	u32 count;
+	const IOSPatch* patches = IOSPATCH_GetPatches(&count);
+
+	PatchScanHits fast[count], slow[count];
+	u64 fastTime = ~0ULL, slowTime = ~0ULL;
+	s32 found = 0;
+	int failed = 0;
+
+	for (u32 run = 0; run < runs; run++)
+	{
+		u64 start = __Now();
+		found = PatchScan_Find(mem, size, patches, count, ALL_SETS, fast);
+		u64 mid = __Now();
+		__Reference(mem, size, patches, count, slow);
+		u64 end = __Now();
+
+		if (mid - start < fastTime)
+			fastTime = mid - start;
+
+		if (end - mid < slowTime)
+			slowTime = end - mid;
+	}
+
+	for (u32 i = 0; i < count; i++)
+	{
+		if (memcmp(&fast[i], &slow[i], sizeof(PatchScanHits)))
+		{
+			printf("%s: %s found %u times, expected %u\n", name, patches[i].name, fast[i].hits, slow[i].hits);
+			failed++;
+		}
+
+		if (!gVerbose)
+			continue;
+
+		printf("  %-32s %3u", patches[i].name, fast[i].hits);
+		for (u32 j = 0; j < fast[i].hits && j < PATCHSCAN_MAX_OFFSETS; j++)
+			printf(" %08x", fast[i].offsets[j]);
+		printf("\n");
+	}
+
+	u8* patched = malloc(size);
+	u8* expected = malloc(size);
+	u32 bytes = 0, expectedBytes = 0;
+
+	if (patched && expected)
+	{
+		memcpy(patched, mem, size);
+		memcpy(expected, mem, size);
+
+		IOSPATCH_ApplyRange(patched, size, ALL_SETS, NULL, &bytes);
+		expectedBytes = __ReferencePatch(expected, size, patches, count);
+
+		if (bytes != expectedBytes || memcmp(patched, expected, size))
+		{
+			printf("%s: patched %u bytes, expected %u\n", name, bytes, expectedBytes);
+			failed++;
+		}
+
+		if (gGolden)
+		{
+			char* report = __Report(patched, size, fast, found, bytes);
+			failed += report ? __Golden(name, report) : 1;
+			free(report);
+		}
+	}
+	else
+		failed++;
+
+	free(patched);
+	free(expected);
+
+	printf("%s: %u bytes, %d matches, %u bytes patched, single pass %.2f ms, per signature %.2f ms\n",
+		name, size, found, bytes, fastTime / 1000.0, slowTime / 1000.0);
+
+	if (gCache)
+		failed += __CacheCheck(name, mem, size);
+
+	return failed;
+}
+
+int main(int argc, char** argv)
+{
+	u32 runs = 3;
+	int failed = 0, opt;
+
+	while ((opt = getopt(argc, argv, "r:c:g:uv")) != -1)
+	{
+		switch (opt)
+		{
+			case 'r': runs = strtoul(optarg, NULL, 0); break;
+			case 'c': gCache = optarg; break;
+			case 'g': gGolden = optarg; break;
+			case 'u': gUpdate = true; break;
+			case 'v': gVerbose = true; break;
+			default:
+				fprintf(stderr, "usage: %s [-r runs] [-c cache] [-g golden [-u]] [-v] [image...]\n", argv[0]);
+				return 2;
+		}
+	}
+
+	if (!runs)
+		runs = 1;
+
+	if (optind == argc)
+	{
+		for (int crowded = 0; crowded < 2; crowded++)
+		{
+			u32 size;
+			u8* mem = __Synthesize(&size, crowded);
+			if (!mem)
+				return 1;
+
+			failed += __Scan(crowded ? "crowded" : "synthetic", mem, size, runs);
+			free(mem);
+		}
+	}
+
+	for (int i = optind; i < argc; i++)
+	{
+		u32 size;
+		u8* mem = __Load(argv[i], &size);
+		if (!mem)
+		{
+			fprintf(stderr, "%s: can't read\n", argv[i]);
+			failed++;
+			continue;
+		}
+
+		failed += __Scan(argv[i], mem, size, runs);
+		free(mem);
+	}
+
+	if (!failed)
+		printf("OK\n");
+
+	return failed ? 1 : 0;
+}
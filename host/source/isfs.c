@@ -0,0 +1,332 @@
+/*
+ * Stand-in ISFS and IOS file descriptors.
+ *
+ * NAND paths are mapped onto a directory on the host ("NAND root"). Only
+ * what the WAD engine touches is implemented, device nodes under /dev
+ * are reported as missing.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "standin.h"
+
+/* Constants */
+#define MAX_FILES	32
+
+static char gRoot[PATH_MAX] = "nand";
+static u8 gCommonKey[16];
+
+static FILE* gFiles[MAX_FILES];
+
+s32 StandIn_SetRoot(const char* path)
+{
+	if (strlen(path) >= sizeof(gRoot))
+		return -1;
+
+	strcpy(gRoot, path);
+
+	/* Trailing slashes would double up when joining */
+	size_t len = strlen(gRoot);
+	while (len > 1 && gRoot[len - 1] == '/')
+		gRoot[--len] = '\0';
+
+	return StandIn_MakePath("/");
+}
+
+const char* StandIn_GetRoot(void)
+{
+	return gRoot;
+}
+
+void StandIn_SetCommonKey(const u8 key[16])
+{
+	memcpy(gCommonKey, key, sizeof(gCommonKey));
+}
+
+const u8* StandIn_GetCommonKey(void)
+{
+	return gCommonKey;
+}
+
+s32 StandIn_Path(const char* nandPath, char* out, size_t size)
+{
+	if (!nandPath || nandPath[0] != '/')
+		return ISFS_EINVAL;
+
+	if ((size_t)snprintf(out, size, "%s%s", gRoot, nandPath) >= size)
+		return ISFS_EINVAL;
+
+	return 0;
+}
+
+static s32 __StandIn_MkDirs(char* path)
+{
+	for (char* p = path + 1; *p; p++)
+	{
+		if (*p != '/')
+			continue;
+
+		*p = '\0';
+		s32 ret = mkdir(path, 0755);
+		*p = '/';
+
+		if (ret < 0 && errno != EEXIST)
+			return -1;
+	}
+
+	if (mkdir(path, 0755) < 0 && errno != EEXIST)
+		return -1;
+
+	return 0;
+}
+
+s32 StandIn_MakePath(const char* nandPath)
+{
+	char path[PATH_MAX];
+
+	if (StandIn_Path(nandPath, path, sizeof(path)) < 0)
+		return ISFS_EINVAL;
+
+	return __StandIn_MkDirs(path);
+}
+
+static s32 __StandIn_RemoveTree(const char* path)
+{
+	struct stat st;
+
+	if (lstat(path, &st) < 0)
+		return STANDIN_ENOENT;
+
+	if (S_ISDIR(st.st_mode))
+	{
+		DIR* dir = opendir(path);
+		if (!dir)
+			return -1;
+
+		struct dirent* ent;
+		while ((ent = readdir(dir)) != NULL)
+		{
+			if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, ".."))
+				continue;
+
+			char child[PATH_MAX];
+			snprintf(child, sizeof(child), "%s/%s", path, ent->d_name);
+			__StandIn_RemoveTree(child);
+		}
+
+		closedir(dir);
+		return rmdir(path) < 0 ? -1 : 0;
+	}
+
+	return unlink(path) < 0 ? -1 : 0;
+}
+
+s32 StandIn_Remove(const char* nandPath)
+{
+	char path[PATH_MAX];
+
+	if (StandIn_Path(nandPath, path, sizeof(path)) < 0)
+		return ISFS_EINVAL;
+
+	return __StandIn_RemoveTree(path);
+}
+
+static s32 __StandIn_Open(const char* nandPath, u32 mode)
+{
+	char path[PATH_MAX];
+	const char* fmode;
+
+	if (!strncmp(nandPath, "/dev/", 5))
+		return IPC_ENOENT;
+
+	if (StandIn_Path(nandPath, path, sizeof(path)) < 0)
+		return ISFS_EINVAL;
+
+	switch (mode)
+	{
+		case ISFS_OPEN_READ:  fmode = "rb";  break;
+		case ISFS_OPEN_WRITE: fmode = "r+b"; break;
+		case ISFS_OPEN_RW:    fmode = "r+b"; break;
+		default: return ISFS_EINVAL;
+	}
+
+	/* Descriptor 0 is never handed out, callers treat it as an error */
+	for (s32 fd = 1; fd < MAX_FILES; fd++)
+	{
+		if (gFiles[fd])
+			continue;
+
+		gFiles[fd] = fopen(path, fmode);
+		if (!gFiles[fd])
+			return STANDIN_ENOENT;
+
+		return fd;
+	}
+
+	return ISFS_ENOMEM;
+}
+
+static FILE* __StandIn_File(s32 fd)
+{
+	if (fd < 1 || fd >= MAX_FILES)
+		return NULL;
+
+	return gFiles[fd];
+}
+
+/* ISFS */
+s32 ISFS_Initialize(void)
+{
+	return ISFS_OK;
+}
+
+s32 ISFS_Deinitialize(void)
+{
+	return ISFS_OK;
+}
+
+s32 ISFS_Open(const char* filepath, u8 mode)
+{
+	return __StandIn_Open(filepath, mode);
+}
+
+s32 ISFS_Close(s32 fd)
+{
+	FILE* fp = __StandIn_File(fd);
+	if (!fp)
+		return ISFS_EINVAL;
+
+	fclose(fp);
+	gFiles[fd] = NULL;
+
+	return ISFS_OK;
+}
+
+s32 ISFS_Seek(s32 fd, s32 where, s32 whence)
+{
+	FILE* fp = __StandIn_File(fd);
+	if (!fp)
+		return ISFS_EINVAL;
+
+	if (fseek(fp, where, whence) < 0)
+		return ISFS_EINVAL;
+
+	return ftell(fp);
+}
+
+s32 ISFS_Read(s32 fd, void* buffer, u32 length)
+{
+	FILE* fp = __StandIn_File(fd);
+	if (!fp)
+		return ISFS_EINVAL;
+
+	return fread(buffer, 1, length, fp);
+}
+
+s32 ISFS_Write(s32 fd, const void* buffer, u32 length)
+{
+	FILE* fp = __StandIn_File(fd);
+	if (!fp)
+		return ISFS_EINVAL;
+
+	return fwrite(buffer, 1, length, fp);
+}
+
+s32 ISFS_CreateFile(const char* filepath, __attribute__((unused)) u8 attributes, __attribute__((unused)) u8 owner_perm, __attribute__((unused)) u8 group_perm, __attribute__((unused)) u8 other_perm)
+{
+	char path[PATH_MAX];
+	struct stat st;
+
+	if (StandIn_Path(filepath, path, sizeof(path)) < 0)
+		return ISFS_EINVAL;
+
+	if (!stat(path, &st))
+		return STANDIN_EEXIST;
+
+	FILE* fp = fopen(path, "wb");
+	if (!fp)
+		return STANDIN_ENOENT;
+
+	fclose(fp);
+	return ISFS_OK;
+}
+
+s32 ISFS_Delete(const char* filepath)
+{
+	return StandIn_Remove(filepath);
+}
+
+s32 ISFS_Rename(const char* filepathOld, const char* filepathNew)
+{
+	char src[PATH_MAX], dst[PATH_MAX];
+
+	if (StandIn_Path(filepathOld, src, sizeof(src)) < 0 || StandIn_Path(filepathNew, dst, sizeof(dst)) < 0)
+		return ISFS_EINVAL;
+
+	if (rename(src, dst) < 0)
+		return STANDIN_ENOENT;
+
+	return ISFS_OK;
+}
+
+s32 ISFS_GetStats(void* stats)
+{
+	/* Cluster size, free and used clusters; an empty 512MiB NAND */
+	u32* out = stats;
+
+	memset(out, 0, 7 * sizeof(u32));
+	out[0] = 0x4000;
+	out[1] = 0x8000;
+
+	return ISFS_OK;
+}
+
+s32 ISFS_GetUsage(__attribute__((unused)) const char* filepath, u32* usage1, u32* usage2)
+{
+	*usage1 = 0;
+	*usage2 = 0;
+
+	return ISFS_OK;
+}
+
+/* IOS file descriptors share the ISFS table */
+s32 IOS_Open(const char* filepath, u32 mode)
+{
+	return __StandIn_Open(filepath, mode);
+}
+
+s32 IOS_Close(s32 fd)
+{
+	return ISFS_Close(fd);
+}
+
+s32 IOS_Seek(s32 fd, s32 where, s32 whence)
+{
+	return ISFS_Seek(fd, where, whence);
+}
+
+s32 IOS_Read(s32 fd, void* buf, s32 len)
+{
+	return ISFS_Read(fd, buf, len);
+}
+
+s32 IOS_Write(s32 fd, const void* buf, s32 len)
+{
+	return ISFS_Write(fd, buf, len);
+}
+
+s32 IOS_Ioctl(__attribute__((unused)) s32 fd, __attribute__((unused)) s32 ioctl, __attribute__((unused)) void* buffer_in, __attribute__((unused)) s32 len_in, __attribute__((unused)) void* buffer_io, __attribute__((unused)) s32 len_io)
+{
+	return IPC_EINVAL;
+}
+
+s32 IOS_Ioctlv(__attribute__((unused)) s32 fd, __attribute__((unused)) s32 ioctl, __attribute__((unused)) s32 cnt_in, __attribute__((unused)) s32 cnt_io, __attribute__((unused)) ioctlv* argv)
+{
+	return IPC_EINVAL;
+}
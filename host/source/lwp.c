@@ -0,0 +1,191 @@
+/* Stand-in LWP threads, mutexes and condition variables on top of pthreads */
+
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
+#include <ogc/cond.h>
+#include <ogc/lwp_watchdog.h>
+
+/* Constants */
+#define MAX_OBJECTS	64
+
+static pthread_mutex_t gTableLock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t       gThreads[MAX_OBJECTS];
+static pthread_mutex_t gMutexes[MAX_OBJECTS];
+static pthread_cond_t  gConds[MAX_OBJECTS];
+
+static bool gThreadUsed[MAX_OBJECTS];
+static bool gMutexUsed[MAX_OBJECTS];
+static bool gCondUsed[MAX_OBJECTS];
+
+static s32 __LWP_Alloc(bool used[])
+{
+	s32 ret = -1;
+
+	pthread_mutex_lock(&gTableLock);
+	for (s32 i = 0; i < MAX_OBJECTS; i++)
+	{
+		if (!used[i])
+		{
+			used[i] = true;
+			ret = i;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&gTableLock);
+
+	return ret;
+}
+
+static void __LWP_Free(bool used[], u32 handle)
+{
+	pthread_mutex_lock(&gTableLock);
+	used[handle] = false;
+	pthread_mutex_unlock(&gTableLock);
+}
+
+/* Threads */
+s32 LWP_CreateThread(lwp_t* thethread, void* (*entry)(void*), void* arg, __attribute__((unused)) void* stackbase, __attribute__((unused)) u32 stack_size, __attribute__((unused)) u8 prio)
+{
+	s32 idx = __LWP_Alloc(gThreadUsed);
+	if (idx < 0)
+		return -1;
+
+	if (pthread_create(&gThreads[idx], NULL, entry, arg))
+	{
+		__LWP_Free(gThreadUsed, idx);
+		return -1;
+	}
+
+	*thethread = idx;
+	return 0;
+}
+
+s32 LWP_JoinThread(lwp_t thethread, void** value_ptr)
+{
+	if (thethread >= MAX_OBJECTS || !gThreadUsed[thethread])
+		return -1;
+
+	pthread_join(gThreads[thethread], value_ptr);
+	__LWP_Free(gThreadUsed, thethread);
+
+	return 0;
+}
+
+void LWP_YieldThread(void)
+{
+	sched_yield();
+}
+
+/* Mutexes */
+s32 LWP_MutexInit(mutex_t* mutex, bool use_recursive)
+{
+	pthread_mutexattr_t attr;
+
+	s32 idx = __LWP_Alloc(gMutexUsed);
+	if (idx < 0)
+		return -1;
+
+	pthread_mutexattr_init(&attr);
+	if (use_recursive)
+		pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+
+	pthread_mutex_init(&gMutexes[idx], &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	*mutex = idx;
+	return 0;
+}
+
+s32 LWP_MutexDestroy(mutex_t mutex)
+{
+	if (mutex >= MAX_OBJECTS || !gMutexUsed[mutex])
+		return -1;
+
+	pthread_mutex_destroy(&gMutexes[mutex]);
+	__LWP_Free(gMutexUsed, mutex);
+
+	return 0;
+}
+
+s32 LWP_MutexLock(mutex_t mutex)
+{
+	return pthread_mutex_lock(&gMutexes[mutex]) ? -1 : 0;
+}
+
+s32 LWP_MutexTryLock(mutex_t mutex)
+{
+	return pthread_mutex_trylock(&gMutexes[mutex]) ? 1 : 0;
+}
+
+s32 LWP_MutexUnlock(mutex_t mutex)
+{
+	return pthread_mutex_unlock(&gMutexes[mutex]) ? -1 : 0;
+}
+
+/* Condition variables */
+s32 LWP_CondInit(cond_t* cond)
+{
+	s32 idx = __LWP_Alloc(gCondUsed);
+	if (idx < 0)
+		return -1;
+
+	pthread_cond_init(&gConds[idx], NULL);
+
+	*cond = idx;
+	return 0;
+}
+
+s32 LWP_CondWait(cond_t cond, mutex_t mutex)
+{
+	return pthread_cond_wait(&gConds[cond], &gMutexes[mutex]) ? -1 : 0;
+}
+
+s32 LWP_CondSignal(cond_t cond)
+{
+	return pthread_cond_signal(&gConds[cond]) ? -1 : 0;
+}
+
+s32 LWP_CondBroadcast(cond_t cond)
+{
+	return pthread_cond_broadcast(&gConds[cond]) ? -1 : 0;
+}
+
+s32 LWP_CondDestroy(cond_t cond)
+{
+	if (cond >= MAX_OBJECTS || !gCondUsed[cond])
+		return -1;
+
+	pthread_cond_destroy(&gConds[cond]);
+	__LWP_Free(gCondUsed, cond);
+
+	return 0;
+}
+
+/* Time base, one tick per nanosecond */
+u64 gettime(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+u32 diff_sec(u64 start, u64 end)
+{
+	return (end - start) / 1000000000ULL;
+}
+
+u32 diff_msec(u64 start, u64 end)
+{
+	return (end - start) / 1000000ULL;
+}
+
+u32 diff_usec(u64 start, u64 end)
+{
+	return (end - start) / 1000ULL;
+}
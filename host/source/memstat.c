@@ -0,0 +1,94 @@
+/*
+ * Heap accounting for the engine.
+ *
+ * Tools that want it link with -Wl,--wrap for the allocator functions, so
+ * every allocation made by the engine and the stand-ins goes through here.
+ * Allocations made inside shared libraries (OpenSSL, libc) are not seen.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "standin.h"
+
+/* Not taken from <malloc.h>, the engine has its own header by that name */
+size_t malloc_usable_size(void* ptr);
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t nmemb, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void* __real_aligned_alloc(size_t alignment, size_t size);
+void  __real_free(void* ptr);
+
+static StandInHeap gHeap;
+
+static void __MemStat_Add(void* ptr)
+{
+	if (!ptr)
+		return;
+
+	u64 now = __atomic_add_fetch(&gHeap.current, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+	u64 peak = __atomic_load_n(&gHeap.peak, __ATOMIC_RELAXED);
+
+	while (now > peak && !__atomic_compare_exchange_n(&gHeap.peak, &peak, now, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+
+	__atomic_add_fetch(&gHeap.allocs, 1, __ATOMIC_RELAXED);
+}
+
+static void __MemStat_Remove(void* ptr)
+{
+	if (ptr)
+		__atomic_sub_fetch(&gHeap.current, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+}
+
+void* __wrap_malloc(size_t size)
+{
+	void* ptr = __real_malloc(size);
+	__MemStat_Add(ptr);
+	return ptr;
+}
+
+void* __wrap_calloc(size_t nmemb, size_t size)
+{
+	void* ptr = __real_calloc(nmemb, size);
+	__MemStat_Add(ptr);
+	return ptr;
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+	__MemStat_Remove(ptr);
+
+	void* out = __real_realloc(ptr, size);
+
+	/* On failure the old block is still there */
+	__MemStat_Add(out ? out : (size ? ptr : NULL));
+	return out;
+}
+
+void* __wrap_aligned_alloc(size_t alignment, size_t size)
+{
+	void* ptr = __real_aligned_alloc(alignment, size);
+	__MemStat_Add(ptr);
+	return ptr;
+}
+
+void __wrap_free(void* ptr)
+{
+	__MemStat_Remove(ptr);
+	__real_free(ptr);
+}
+
+void StandIn_GetHeap(StandInHeap* out)
+{
+	out->current = __atomic_load_n(&gHeap.current, __ATOMIC_RELAXED);
+	out->peak    = __atomic_load_n(&gHeap.peak, __ATOMIC_RELAXED);
+	out->allocs  = __atomic_load_n(&gHeap.allocs, __ATOMIC_RELAXED);
+}
+
+void StandIn_ResetHeapPeak(void)
+{
+	__atomic_store_n(&gHeap.peak, __atomic_load_n(&gHeap.current, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+	__atomic_store_n(&gHeap.allocs, 0, __ATOMIC_RELAXED);
+}
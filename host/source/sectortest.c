@@ -0,0 +1,289 @@
+/*
+ * sectortest - checks and benchmarks the USB sector cache.
+ *
+ *   sectortest [-s seed] [-v]
+ *
+ * The device is a RAM disk that takes a while for every transfer, like a
+ * USB stick. Random reads and writes through the cache have to return what
+ * a plain copy of the disk holds, with every combination of cache sizes.
+ * Then a file is read from start to end, as an install does with a little
+ * work between reads, and a directory is walked page by page, each timed
+ * through the cache and straight from the device. -v prints the cache
+ * statistics of every run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <gccore.h>
+#include "sectorcache.h"
+
+/* Constants */
+#define SECTOR_SIZE		512
+#define DISK_SECTORS	0x10000					// 32 MiB
+#define CHECK_OPS		5000
+
+/* A transfer costs this much and this much more per sector, in microseconds */
+#define IO_LATENCY		200
+#define IO_PER_SECTOR	2
+
+static u8* gDisk;
+static u32 gTransfers;
+static u32 gRefused;
+static bool gSlow;
+static bool gVerbose = false;
+
+static u64 __Now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static bool __DiskIO(u32 sector, u32 count, u8* buffer, bool write)
+{
+	if (sector >= DISK_SECTORS || count > DISK_SECTORS - sector)
+	{
+		__atomic_add_fetch(&gRefused, 1, __ATOMIC_RELAXED);
+		return false;
+	}
+
+	if (gSlow)
+		usleep(IO_LATENCY + count * IO_PER_SECTOR);
+
+	if (write)
+		memcpy(gDisk + sector * SECTOR_SIZE, buffer, count * SECTOR_SIZE);
+	else
+		memcpy(buffer, gDisk + sector * SECTOR_SIZE, count * SECTOR_SIZE);
+
+	__atomic_add_fetch(&gTransfers, 1, __ATOMIC_RELAXED);
+	return true;
+}
+
+static void __PrintStats(const char* name)
+{
+	SectorCacheStats stats;
+	SectorCache_GetStats(&stats);
+
+	u64 hits = stats.recentHits + stats.aheadHits;
+
+	printf("%s: %u reads, %u writes, %llu sectors, %.1f%% hits (%llu recent, %llu ahead), %llu missed, "
+		"%u prefetches, %u waits %.2f ms, %u transfers\n",
+		name, stats.reads, stats.writes, (unsigned long long)stats.sectors,
+		stats.sectors ? 100.0 * hits / stats.sectors : 0.0,
+		(unsigned long long)stats.recentHits, (unsigned long long)stats.aheadHits, (unsigned long long)stats.misses,
+		stats.prefetches, stats.aheadWaits, stats.waitTime / 1000.0, gTransfers);
+}
+
+/* Sequential runs, pages read again, random sectors and writes in between */
+static int __Check(u32 size, u32 ahead)
+{
+	static u8 model[DISK_SECTORS * SECTOR_SIZE];
+	static u8 buffer[512 * SECTOR_SIZE];
+	char name[64];
+	u32 next = 0;
+	int failed = 0;
+
+	memcpy(model, gDisk, sizeof(model));
+
+	gSlow = false;
+	gTransfers = 0;
+	gRefused = 0;
+	SectorCache_ResetStats();
+	SectorCache_SetSize(size, ahead);
+	SectorCache_Init(__DiskIO, SECTOR_SIZE, DISK_SECTORS);
+
+	for (u32 op = 0; op < CHECK_OPS && !failed; op++)
+	{
+		u32 kind = rand() % 10, sector, count;
+
+		if (kind < 4)
+		{
+			sector = next;
+			count = 1 + rand() % 256;
+		}
+		else if (kind < 7)
+		{
+			sector = (rand() % 64) * SECTORCACHE_BLOCK_SECTORS;
+			count = SECTORCACHE_BLOCK_SECTORS;
+		}
+		else
+		{
+			sector = rand() % DISK_SECTORS;
+			count = 1 + rand() % 512;
+		}
+
+		if (sector >= DISK_SECTORS)
+			sector = 0;
+
+		if (count > DISK_SECTORS - sector)
+			count = DISK_SECTORS - sector;
+
+		next = sector + count;
+
+		if (kind == 9 || kind == 6)
+		{
+			u32 stamp = rand();
+			for (u32 i = 0; i < count * SECTOR_SIZE; i += 4)
+			{
+				memcpy(buffer + i, &stamp, 4);
+				stamp = stamp * 1664525 + 1013904223;
+			}
+
+			memcpy(model + sector * SECTOR_SIZE, buffer, count * SECTOR_SIZE);
+
+			if (!SectorCache_Write(sector, count, buffer))
+			{
+				printf("write of %u sectors at %u failed\n", count, sector);
+				failed++;
+			}
+
+			continue;
+		}
+
+		if (!SectorCache_Read(sector, count, buffer) || memcmp(buffer, model + sector * SECTOR_SIZE, count * SECTOR_SIZE))
+		{
+			printf("read of %u sectors at %u differs from the disk\n", count, sector);
+			failed++;
+		}
+	}
+
+	/* Reading ahead stops at the end of the disk */
+	if (!failed && (!SectorCache_Read(DISK_SECTORS - 8, 8, buffer) || !SectorCache_Read(DISK_SECTORS - 8, 8, buffer)
+	||  memcmp(buffer, model + (DISK_SECTORS - 8) * SECTOR_SIZE, 8 * SECTOR_SIZE)))
+	{
+		printf("read at the end of the disk failed\n");
+		failed++;
+	}
+
+	/* and so does a read past it, without the cache answering */
+	if (!failed && SectorCache_Read(DISK_SECTORS - 8, 16, buffer))
+	{
+		printf("read past the end of the disk worked\n");
+		failed++;
+	}
+
+	if (!failed && gRefused != 1)
+	{
+		printf("%u reads went past the end of the disk\n", gRefused - 1);
+		failed++;
+	}
+
+	SectorCache_Deinit();
+
+	snprintf(name, sizeof(name), "check %u KiB cache, %u KiB ahead", size / 1024, ahead / 1024);
+	if (gVerbose || failed)
+		__PrintStats(name);
+
+	if (failed)
+		printf("%s: FAILED\n", name);
+
+	return failed;
+}
+
+/* A 16 MiB file in 64 KiB reads, its FAT every 16 reads */
+static u64 __Stream(void)
+{
+	static u8 buffer[128 * SECTOR_SIZE];
+	u64 start = __Now();
+
+	for (u32 i = 0; i < 256; i++)
+	{
+		if (!(i % 16))
+			SectorCache_Read(SECTORCACHE_BLOCK_SECTORS * (1 + i / 128), SECTORCACHE_BLOCK_SECTORS, buffer);
+
+		SectorCache_Read(0x4000 + i * 128, 128, buffer);
+
+		/* Handing it to ES */
+		usleep(300);
+	}
+
+	return __Now() - start;
+}
+
+/* 2000 lookups over 12 pages of directories and FAT */
+static u64 __Walk(void)
+{
+	static u8 buffer[SECTORCACHE_BLOCK_SECTORS * SECTOR_SIZE];
+	u64 start = __Now();
+
+	srand(7);
+
+	for (u32 i = 0; i < 2000; i++)
+		SectorCache_Read(0x200 + (rand() % 12) * SECTORCACHE_BLOCK_SECTORS, SECTORCACHE_BLOCK_SECTORS, buffer);
+
+	return __Now() - start;
+}
+
+static void __Bench(const char* name, u64 (*run)(void))
+{
+	u64 direct, cached;
+
+	gSlow = true;
+
+	SectorCache_SetSize(0, 0);
+	SectorCache_Init(__DiskIO, SECTOR_SIZE, DISK_SECTORS);
+	gTransfers = 0;
+	direct = run();
+	SectorCache_Deinit();
+
+	SectorCache_SetSize(SECTORCACHE_DEFAULT_SIZE, SECTORCACHE_DEFAULT_AHEAD);
+	SectorCache_Init(__DiskIO, SECTOR_SIZE, DISK_SECTORS);
+	SectorCache_ResetStats();
+	gTransfers = 0;
+	cached = run();
+	SectorCache_Deinit();
+
+	printf("%s: %.1f ms cached, %.1f ms direct\n", name, cached / 1000.0, direct / 1000.0);
+	__PrintStats(name);
+}
+
+int main(int argc, char** argv)
+{
+	static const u32 sizes[][2] = {
+		{ 0, 0 },
+		{ SECTORCACHE_DEFAULT_SIZE, 0 },
+		{ 0, SECTORCACHE_DEFAULT_AHEAD },
+		{ SECTORCACHE_DEFAULT_SIZE, SECTORCACHE_DEFAULT_AHEAD },
+		{ 0x8000, 0x1000 },
+	};
+
+	u32 seed = 1;
+	int failed = 0, opt;
+
+	while ((opt = getopt(argc, argv, "s:v")) != -1)
+	{
+		switch (opt)
+		{
+			case 's': seed = strtoul(optarg, NULL, 0); break;
+			case 'v': gVerbose = true; break;
+			default:
+				fprintf(stderr, "usage: %s [-s seed] [-v]\n", argv[0]);
+				return 2;
+		}
+	}
+
+	gDisk = malloc(DISK_SECTORS * SECTOR_SIZE);
+	if (!gDisk)
+		return 1;
+
+	srand(seed);
+	for (u32 i = 0; i < DISK_SECTORS * SECTOR_SIZE; i++)
+		gDisk[i] = rand();
+
+	for (u32 i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+		failed += __Check(sizes[i][0], sizes[i][1]);
+
+	__Bench("stream", __Stream);
+	__Bench("walk", __Walk);
+
+	free(gDisk);
+
+	if (!failed)
+		printf("OK\n");
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * sha1test - checks and benchmarks the engine's SHA-1.
+ *
+ *   sha1test        FIPS 180-1 vectors, then random lengths, split points
+ *                   and misaligned buffers against OpenSSL
+ *   sha1test -b     throughput on an 8 MiB buffer, aligned and not
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+
+#include <gccore.h>
+#include "sha1.h"
+
+/* Constants */
+#define RANDOM_SIZE	0x4000
+#define BENCH_SIZE	(8 << 20)
+#define BENCH_LOOPS	16
+
+static const struct
+{
+	const char* message;
+	u32 repeat;
+	const char* digest;
+} gVectors[] =
+{
+	{ "abc", 1, "a9993e364706816aba3e25717850c26c9cd0d89d" },
+	{ "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1, "84983e441c3bd26ebaae4aa1f95129e5e54670f1" },
+	{ "a", 1000000, "34aa973cd4c4daa4f61eeb2bdbad27316534016f" },
+	{ "", 1, "da39a3ee5e6b4b0d3255bfef95601890afd80709" },
+};
+
+static void __Hex(const u8 digest[20], char out[41])
+{
+	for (int i = 0; i < 20; i++)
+		sprintf(out + i * 2, "%02x", digest[i]);
+}
+
+static void __Reference(const u8* data, u32 len, u8 digest[20])
+{
+	EVP_Digest(data, len, digest, NULL, EVP_sha1(), NULL);
+}
+
+static int __Vectors(void)
+{
+	int failed = 0;
+
+	for (u32 i = 0; i < sizeof(gVectors) / sizeof(gVectors[0]); i++)
+	{
+		SHA1_CTX ctx;
+		u8 digest[20];
+		char hex[41];
+
+		SHA1Init(&ctx);
+		for (u32 j = 0; j < gVectors[i].repeat; j++)
+			SHA1Update(&ctx, gVectors[i].message, strlen(gVectors[i].message));
+		SHA1Final(digest, &ctx);
+
+		__Hex(digest, hex);
+		if (strcmp(hex, gVectors[i].digest))
+		{
+			printf("FAIL vector %u: %s, expected %s\n", i, hex, gVectors[i].digest);
+			failed++;
+		}
+	}
+
+	return failed;
+}
+
+/* Every length around the padding boundaries, then random cases */
+static int __Random(void)
+{
+	static u8 buffer[RANDOM_SIZE + 64];
+	int failed = 0;
+
+	srand(1);
+	for (u32 i = 0; i < sizeof(buffer); i++)
+		buffer[i] = rand();
+
+	for (u32 i = 0; i < 2000 + 192; i++)
+	{
+		u32 len    = (i < 192) ? i : (u32)rand() % RANDOM_SIZE;
+		u32 offset = rand() % 64;
+		u32 split  = len ? (u32)rand() % len : 0;
+		u8* data   = buffer + offset;
+		u8 expect[20], whole[20], parts[20];
+		SHA1_CTX ctx;
+
+		__Reference(data, len, expect);
+		SHA1(data, len, whole);
+
+		SHA1Init(&ctx);
+		SHA1Update(&ctx, data, split);
+		SHA1Update(&ctx, data + split, len - split);
+		SHA1Final(parts, &ctx);
+
+		if (memcmp(expect, whole, 20) || memcmp(expect, parts, 20))
+		{
+			printf("FAIL length %u, offset %u, split %u\n", len, offset, split);
+			failed++;
+		}
+	}
+
+	return failed;
+}
+
+static double __Time(const u8* data, u32 len, bool reference)
+{
+	u8 digest[20];
+	u64 start = gettime();
+
+	for (int i = 0; i < BENCH_LOOPS; i++)
+	{
+		if (reference)
+			__Reference(data, len, digest);
+		else
+			SHA1((u8*)data, len, digest);
+	}
+
+	double seconds = diff_usec(start, gettime()) / 1000000.0;
+	return (double)len * BENCH_LOOPS / 1048576.0 / seconds;
+}
+
+static void __Bench(void)
+{
+	u8* buffer = malloc(BENCH_SIZE + 64);
+	if (!buffer)
+		return;
+
+	for (u32 i = 0; i < BENCH_SIZE + 64; i++)
+		buffer[i] = i * 2654435761U >> 24;
+
+	printf("engine aligned:    %8.1f MB/s\n", __Time(buffer, BENCH_SIZE, false));
+	printf("engine unaligned:  %8.1f MB/s\n", __Time(buffer + 3, BENCH_SIZE, false));
+	printf("openssl aligned:   %8.1f MB/s\n", __Time(buffer, BENCH_SIZE, true));
+
+	free(buffer);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && !strcmp(argv[1], "-b"))
+	{
+		__Bench();
+		return 0;
+	}
+
+	int failed = __Vectors() + __Random();
+	printf("%s\n", failed ? "FAILED" : "OK");
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,57 @@
+#ifndef _STANDIN_H_
+#define _STANDIN_H_
+
+#include <gccore.h>
+
+/* ISFS error codes used by the stand-in */
+#define STANDIN_EEXIST		-105
+#define STANDIN_ENOENT		-106
+
+/* Content hash mismatch, as reported by ES */
+#define STANDIN_EHASH		-1022
+
+/* Time spent in the stand-in ES, in microseconds */
+typedef struct
+{
+	/* Ticket and TMD lookups */
+	u64 lookupTime;
+
+	u64 ticketTime;
+	u64 titleStartTime;
+
+	/* Content import, from start to finish */
+	u32 contents;
+	u64 contentBytes;
+	u64 contentTime;
+
+	u64 titleFinishTime;
+	u64 deleteTime;
+} StandInStats;
+
+/* Heap usage of the engine, see memstat.c */
+typedef struct
+{
+	u64 current;
+	u64 peak;
+	u32 allocs;
+} StandInHeap;
+
+/* Prototypes */
+s32  StandIn_SetRoot(const char* path);
+const char* StandIn_GetRoot(void);
+void StandIn_SetCommonKey(const u8 key[16]);
+const u8* StandIn_GetCommonKey(void);
+
+s32  StandIn_Path(const char* nandPath, char* out, size_t size);
+s32  StandIn_MakePath(const char* nandPath);
+s32  StandIn_Remove(const char* nandPath);
+
+s32  StandIn_SeedSystem(u16 smVersion, u32 smIOS, const char* area);
+
+void StandIn_GetStats(StandInStats* out);
+void StandIn_ResetStats(void);
+
+void StandIn_GetHeap(StandInHeap* out);
+void StandIn_ResetHeapPeak(void);
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * Stand-ins for the console-only pieces the WAD engine links against:
+ * video, controllers, menu hooks, IOS reloads and the OTP/SEEPROM readers.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "standin.h"
+#include "mini_seeprom.h"
+#include "otp.h"
+#include "mload.h"
+#include "ehcmodule_elf.h"
+#include <wiiuse/wpad.h>
+
+const u8 ehcmodule_elf[1];
+const u32 ehcmodule_elf_size = 0;
+
+/* Video and system */
+void VIDEO_Init(void)
+{
+}
+
+resetcallback SYS_SetResetCallback(__attribute__((unused)) resetcallback cb)
+{
+	return NULL;
+}
+
+powercallback SYS_SetPowerCallback(__attribute__((unused)) powercallback cb)
+{
+	return NULL;
+}
+
+s32 STM_RebootSystem(void)
+{
+	return 0;
+}
+
+s32 STM_ShutdownToStandby(void)
+{
+	return 0;
+}
+
+/* One line per step instead of redrawing it */
+void Con_ClearLine(void)
+{
+	putchar('\n');
+}
+
+/* Unattended: every prompt is answered with A */
+u32 WaitButtons(void)
+{
+	return WPAD_BUTTON_A;
+}
+
+void SetPriiloaderOption(__attribute__((unused)) bool enabled)
+{
+}
+
+/* IOS */
+s32 IOS_GetVersion(void)
+{
+	return 58;
+}
+
+s32 IOS_GetRevision(void)
+{
+	return 6176;
+}
+
+s32 IOS_ReloadIOS(__attribute__((unused)) int version)
+{
+	return 0;
+}
+
+int mload_init(void)
+{
+	return -1;
+}
+
+int mload_close(void)
+{
+	return 0;
+}
+
+int mload_elf(__attribute__((unused)) void* my_elf, __attribute__((unused)) data_elf* data_elf)
+{
+	return -1;
+}
+
+int mload_run_thread(__attribute__((unused)) void* starlet_addr, __attribute__((unused)) void* starlet_top_stack, __attribute__((unused)) int stack_size, __attribute__((unused)) int priority)
+{
+	return -1;
+}
+
+/* Key storage */
+u16 seeprom_read(__attribute__((unused)) void* dst, __attribute__((unused)) u16 offset, __attribute__((unused)) u16 size)
+{
+	/* No SEEPROM, so no Korean key either */
+	return 0;
+}
+
+u8 otp_read(void* dst, u8 offset, u8 size)
+{
+	otp_t otp = {};
+
+	if (offset + size > sizeof(otp))
+		return 0;
+
+	memcpy(otp.common_key, StandIn_GetCommonKey(), sizeof(otp.common_key));
+	memcpy(dst, (u8*)&otp + offset, size);
+
+	return size;
+}
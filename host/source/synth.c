@@ -0,0 +1,282 @@
+/*
+ * Synthetic WAD writer.
+ *
+ * Content data is pseudo random from the seed, so the same description
+ * always gives the same WAD. Contents are encrypted and hashed like the
+ * real thing; signatures are left empty, which the stand-in ES accepts.
+ * Shared contents only depend on their index, so different synthetic
+ * titles share them like real titles do.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+
+#include "synth.h"
+
+/* Constants */
+#define CERTS_LEN	0xA00
+#define CHUNK_SIZE	0x10000
+
+typedef struct {
+	u32 header_len;
+	u16 type;
+	u16 padding;
+	u32 certs_len;
+	u32 crl_len;
+	u32 tik_len;
+	u32 tmd_len;
+	u32 data_len;
+	u32 footer_len;
+} ATTRIBUTE_PACKED wadHeader;
+
+typedef struct {
+	sig_rsa2048 sig;
+	tik ticket;
+} ATTRIBUTE_PACKED signedTik;
+
+void Synth_Init(SynthWad* wad)
+{
+	memset(wad, 0, sizeof(*wad));
+
+	wad->titleID  = 0x0001000157484D41ULL;
+	wad->ios      = 58;
+	wad->version  = 1;
+	wad->contents = 1;
+	wad->size     = 1 << 20;
+	wad->seed     = 0x5EED;
+}
+
+bool Synth_ParseKey(const char* hex, u8 key[16])
+{
+	if (strlen(hex) != 32)
+		return false;
+
+	for (int i = 0; i < 16; i++)
+	{
+		unsigned int byte;
+		if (sscanf(hex + i * 2, "%2x", &byte) != 1)
+			return false;
+
+		key[i] = byte;
+	}
+
+	return true;
+}
+
+u64 Synth_ParseSize(const char* str)
+{
+	char* end;
+	u64 value = strtoull(str, &end, 0);
+
+	switch (*end)
+	{
+		case 'k': case 'K': value <<= 10; break;
+		case 'm': case 'M': value <<= 20; break;
+		case 'g': case 'G': value <<= 30; break;
+	}
+
+	return value;
+}
+
+/* xorshift64*, good enough for filler that doesn't compress */
+static u64 __Synth_Random(u64* state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static s32 __Synth_Write(FILE* fp, const void* data, u32 len)
+{
+	static const u8 zero[64];
+	u32 pad = ((len + 63) & ~63) - len;
+
+	if (fwrite(data, 1, len, fp) != len || fwrite(zero, 1, pad, fp) != pad)
+		return -1;
+
+	return 0;
+}
+
+static s32 __Synth_WriteContent(FILE* fp, const u8 titleKey[16], tmd_content* content, u64 seed)
+{
+	static u8 plain[CHUNK_SIZE], crypt[CHUNK_SIZE];
+	u8 hash[EVP_MAX_MD_SIZE];
+	u8 iv[16] = {};
+	unsigned int hashLen;
+	s32 ret = -1;
+
+	EVP_CIPHER_CTX* aes = EVP_CIPHER_CTX_new();
+	EVP_MD_CTX* sha = EVP_MD_CTX_new();
+
+	if (!aes || !sha)
+		goto out;
+
+	iv[0] = content->index >> 8;
+	iv[1] = content->index;
+
+	EVP_EncryptInit_ex(aes, EVP_aes_128_cbc(), NULL, titleKey, iv);
+	EVP_CIPHER_CTX_set_padding(aes, 0);
+	EVP_DigestInit_ex(sha, EVP_sha1(), NULL);
+
+	/* Contents are zero padded to 64 bytes before encryption */
+	u64 left  = content->size;
+	u64 total = (content->size + 63) & ~63ULL;
+
+	for (u64 done = 0; done < total;)
+	{
+		u32 size = (total - done > CHUNK_SIZE) ? CHUNK_SIZE : (u32)(total - done);
+		u32 data = (left < size) ? (u32)left : size;
+		int len = 0;
+
+		for (u32 i = 0; i < data; i += 8)
+		{
+			u64 r = __Synth_Random(&seed);
+			memcpy(plain + i, &r, (data - i < 8) ? data - i : 8);
+		}
+		memset(plain + data, 0, size - data);
+
+		EVP_DigestUpdate(sha, plain, data);
+		EVP_EncryptUpdate(aes, crypt, &len, plain, size);
+
+		if (fwrite(crypt, 1, size, fp) != size)
+			goto out;
+
+		left -= data;
+		done += size;
+	}
+
+	EVP_DigestFinal_ex(sha, hash, &hashLen);
+	memcpy(content->hash, hash, sizeof(sha1));
+
+	ret = 0;
+
+out:
+	EVP_CIPHER_CTX_free(aes);
+	EVP_MD_CTX_free(sha);
+	return ret;
+}
+
+s64 Synth_WriteWad(const char* path, const SynthWad* wad)
+{
+	static u8 certs[CERTS_LEN];
+	static signedTik s_tik;
+
+	signed_blob* s_tmd = NULL;
+	u32 contents = wad->contents, shared = wad->shared;
+	u16 version = wad->version;
+	u64 seed = wad->seed | 1;
+	u8 titleKey[16], iv[16] = {};
+	s64 ret = -1;
+	int len;
+
+	if (wad->stub)
+	{
+		contents = 3;
+		shared   = 2;
+		version  = 0xFF00;
+	}
+
+	if (!contents || contents > MAX_NUM_TMD_CONTENTS || shared > contents)
+		return -1;
+
+	FILE* fp = fopen(path, "wb");
+	if (!fp)
+		return -1;
+
+	/* Title key, encrypted with the common key and the title ID as IV */
+	for (int i = 0; i < 16; i++)
+		titleKey[i] = (u8)(__Synth_Random(&seed) >> 56);
+
+	for (int i = 0; i < 8; i++)
+		iv[i] = wad->titleID >> (56 - i * 8);
+
+	memset(&s_tik, 0, sizeof(s_tik));
+
+	EVP_CIPHER_CTX* aes = EVP_CIPHER_CTX_new();
+	EVP_EncryptInit_ex(aes, EVP_aes_128_cbc(), NULL, wad->commonKey, iv);
+	EVP_CIPHER_CTX_set_padding(aes, 0);
+	EVP_EncryptUpdate(aes, s_tik.ticket.cipher_title_key, &len, titleKey, sizeof(titleKey));
+	EVP_CIPHER_CTX_free(aes);
+
+	/* Ticket */
+	s_tik.sig.type = ES_SIG_RSA2048;
+	strcpy(s_tik.ticket.issuer, "Root-CA00000001-XS00000003");
+	s_tik.ticket.titleid = wad->titleID;
+	s_tik.ticket.access_mask = 0xFFFF;
+	memset(s_tik.ticket.cidx_mask, 0xFF, sizeof(s_tik.ticket.cidx_mask));
+
+	/* TMD */
+	u32 tmdLen = sizeof(sig_rsa2048) + sizeof(tmd) + contents * sizeof(tmd_content);
+	s_tmd = calloc(1, tmdLen);
+	if (!s_tmd)
+		goto out;
+
+	((sig_rsa2048*)s_tmd)->type = ES_SIG_RSA2048;
+	tmd* p_tmd = SIGNATURE_PAYLOAD(s_tmd);
+
+	strcpy(p_tmd->issuer, "Root-CA00000001-CP00000004");
+	p_tmd->sys_version   = ((wad->titleID >> 32) == 1) ? 0 : (0x100000000ULL | wad->ios);
+	p_tmd->title_id      = wad->titleID;
+	p_tmd->title_type    = 1;
+	p_tmd->title_version = version;
+	p_tmd->num_contents  = contents;
+
+	u64 dataLen = 0;
+	for (u32 i = 0; i < contents; i++)
+	{
+		p_tmd->contents[i].cid   = i;
+		p_tmd->contents[i].index = i;
+		p_tmd->contents[i].type  = (i >= contents - shared) ? 0x8001 : 0x0001;
+		p_tmd->contents[i].size  = (i == 0 && contents > 1 && !wad->stub) ? 0x4000 : wad->size;
+
+		dataLen += (p_tmd->contents[i].size + 63) & ~63ULL;
+	}
+
+	/* Header */
+	wadHeader header = {};
+	header.header_len = 0x20;
+	header.type       = 'I' << 8 | 's';
+	header.certs_len  = CERTS_LEN;
+	header.tik_len    = sizeof(s_tik);
+	header.tmd_len    = tmdLen;
+	header.data_len   = (dataLen > 0xFFFFFFFF) ? 0xFFFFFFFF : (u32)dataLen;
+
+	if (__Synth_Write(fp, &header, sizeof(header)) < 0 ||
+		__Synth_Write(fp, certs, sizeof(certs)) < 0 ||
+		__Synth_Write(fp, &s_tik, sizeof(s_tik)) < 0)
+		goto out;
+
+	/* The TMD is written again once the content hashes are known */
+	long tmdOffset = ftell(fp);
+	if (__Synth_Write(fp, s_tmd, tmdLen) < 0)
+		goto out;
+
+	for (u32 i = 0; i < contents; i++)
+	{
+		tmd_content* content = &p_tmd->contents[i];
+		u64 contentSeed = (content->type & 0x8000) ? 0x5A4ED000 + i : wad->seed + (i + 1) * 0x9E3779B97F4A7C15ULL;
+
+		if (__Synth_WriteContent(fp, titleKey, content, contentSeed | 1) < 0)
+			goto out;
+	}
+
+	ret = ftell(fp);
+
+	fseek(fp, tmdOffset, SEEK_SET);
+	if (fwrite(s_tmd, 1, tmdLen, fp) != tmdLen)
+		ret = -1;
+
+out:
+	free(s_tmd);
+
+	if (fclose(fp) && ret >= 0)
+		ret = -1;
+
+	if (ret < 0)
+		remove(path);
+
+	return ret;
+}
@@ -0,0 +1,35 @@
+#ifndef _SYNTH_H_
+#define _SYNTH_H_
+
+#include <gccore.h>
+
+/* Synthetic WAD description */
+typedef struct
+{
+	u64 titleID;
+
+	/* IOS the title runs on, unused for IOS titles */
+	u32 ios;
+	u16 version;
+
+	/* Number of contents, the last ones being shared */
+	u32 contents;
+	u32 shared;
+
+	/* Size of every content; the first one of a multi-content title is small, like a banner */
+	u64 size;
+
+	/* One private and two shared contents at version 0xFF00 */
+	bool stub;
+
+	u64 seed;
+	u8 commonKey[16];
+} SynthWad;
+
+/* Prototypes */
+void Synth_Init(SynthWad* wad);
+s64  Synth_WriteWad(const char* path, const SynthWad* wad);
+bool Synth_ParseKey(const char* hex, u8 key[16]);
+u64  Synth_ParseSize(const char* str);
+
+#endif
@@ -0,0 +1,408 @@
+/*
+ * wadbench - install throughput benchmark.
+ *
+ *   wadbench [-w workdir] [-o results.jsonl] [-d depth] [-r runs] [-q] [-v] [-V] [-S] [scenario...]
+ *
+ * Synthetic WADs are generated once into <workdir>/wads and installed into
+ * a fresh stand-in NAND at <workdir>/nand for every run. Each timed
+ * operation is written as one JSON object per line: wall time, MB/s, time
+ * per phase and the engine's peak heap usage, plus the buffer settings the
+ * engine was built with so results can be compared between builds.
+ *
+ * Phases are in microseconds. es_* is time spent inside the stand-in ES,
+ * pipe_* comes from the content pipeline (pipe_read and pipe_write overlap
+ * with each other and with es_content), other is everything that was
+ * neither ES nor waiting for WAD data: parsing, checks, console output.
+ *
+ * -q uses small sizes for the large contents, for quick checks and CI.
+ * -V installs with content verification, pipe_verify is its share of
+ * pipe_read. -S installs strictly one WAD after the other, without reading
+ * the next one while the current one installs.
+ *
+ * arena is what the per-WAD arenas saw: their peak use, bytes lost to
+ * alignment and how often a request didn't fit and went to the heap.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+#include "standin.h"
+#include "synth.h"
+#include "title.h"
+#include "sys.h"
+#include "wad.h"
+#include "wadpipe.h"
+
+#define TITLE_ID(x, y)	(((u64)(x) << 32) | (y))
+
+/* Synthetic WADs used by the scenarios */
+typedef struct
+{
+	const char* name;
+	u64 titleID;
+	bool stub;
+	u32 contents;
+	u32 shared;
+	u64 size;
+
+	/* Content size with -q */
+	u64 quickSize;
+} BenchWad;
+
+static const BenchWad gWads[] =
+{
+	{ "ios254-stub",   TITLE_ID(1, 254),               true,   3, 2, 0x10000,   0x10000   },
+	{ "ios58",         TITLE_ID(1, 58),                false, 20, 3, 0x30000,   0x30000   },
+	{ "channel-1",     TITLE_ID(0x10001, 0x57424E31),  false,  1, 0, 0x40000,   0x40000   },
+	{ "channel-40",    TITLE_ID(0x10001, 0x57424E34),  false, 40, 8, 0x80000,   0x20000   },
+	{ "large",         TITLE_ID(0x10001, 0x57424C47),  false,  3, 0, 192 << 20, 16 << 20  },
+	{ "batch-a",       TITLE_ID(0x10001, 0x57424241),  false,  6, 2, 2 << 20,   0x40000   },
+	{ "batch-b",       TITLE_ID(0x10001, 0x57424242),  false,  6, 2, 2 << 20,   0x40000   },
+	{ "batch-c",       TITLE_ID(0x10001, 0x57424243),  false,  6, 2, 2 << 20,   0x40000   },
+	{ "batch-d",       TITLE_ID(0x10001, 0x57424244),  false,  6, 2, 2 << 20,   0x40000   },
+	{ "small-a",       TITLE_ID(0x10001, 0x57425341),  false,  1, 0, 0x4000,    0x4000    },
+	{ "small-b",       TITLE_ID(0x10001, 0x57425342),  false,  1, 0, 0x4000,    0x4000    },
+	{ "small-c",       TITLE_ID(0x10001, 0x57425343),  false,  1, 0, 0x4000,    0x4000    },
+	{ "small-d",       TITLE_ID(0x10001, 0x57425344),  false,  1, 0, 0x4000,    0x4000    },
+	{ "small-e",       TITLE_ID(0x10001, 0x57425345),  false,  1, 0, 0x4000,    0x4000    },
+	{ "small-f",       TITLE_ID(0x10001, 0x57425346),  false,  1, 0, 0x4000,    0x4000    },
+};
+
+#define NUM_WADS	(sizeof(gWads) / sizeof(gWads[0]))
+#define MAX_BATCH	8
+
+/* A scenario installs its WADs as one batch and then uninstalls them */
+typedef struct
+{
+	const char* name;
+
+	/* Installed untimed before every run */
+	const char* setup[MAX_BATCH];
+
+	const char* wads[MAX_BATCH];
+} BenchScenario;
+
+static const BenchScenario gScenarios[] =
+{
+	{ "ios-stub",   { NULL },    { "ios254-stub", NULL } },
+	{ "ios",        { NULL },    { "ios58", NULL } },
+	{ "channel-1",  { "ios58" }, { "channel-1", NULL } },
+	{ "channel-40", { "ios58" }, { "channel-40", NULL } },
+	{ "large",      { "ios58" }, { "large", NULL } },
+	{ "batch",      { NULL },    { "ios58", "batch-a", "batch-b", "batch-c", "batch-d", NULL } },
+	{ "small",      { "ios58" }, { "small-a", "small-b", "small-c", "small-d", "small-e", "small-f", NULL } },
+};
+
+#define NUM_SCENARIOS	(sizeof(gScenarios) / sizeof(gScenarios[0]))
+
+static char gWorkDir[256] = "bench";
+static bool gQuick = false;
+static bool gVerbose = false;
+static bool gPrefetch = true;
+
+/* Where results go, the engine's own output is usually silenced */
+static FILE* gOut;
+static int gStdout = -1;
+static int gNull = -1;
+
+static void __Usage(void)
+{
+	fprintf(stderr, "usage: wadbench [-w workdir] [-o results.jsonl] [-d depth] [-r runs] [-q] [-v] [-V] [-S] [scenario...]\n");
+	exit(2);
+}
+
+static void __Silence(bool on)
+{
+	if (gVerbose)
+		return;
+
+	fflush(stdout);
+	dup2(on ? gNull : gStdout, STDOUT_FILENO);
+}
+
+static const BenchWad* __FindWad(const char* name)
+{
+	for (u32 i = 0; i < NUM_WADS; i++)
+	{
+		if (!strcmp(gWads[i].name, name))
+			return &gWads[i];
+	}
+
+	return NULL;
+}
+
+static void __WadPath(char* out, size_t size, const BenchWad* wad)
+{
+	snprintf(out, size, "%s/wads/%s%s.wad", gWorkDir, wad->name, gQuick ? "-q" : "");
+}
+
+static s32 __Generate(const BenchWad* wad)
+{
+	char path[512];
+	struct stat st;
+	SynthWad synth;
+
+	__WadPath(path, sizeof(path), wad);
+	if (!stat(path, &st))
+		return 0;
+
+	Synth_Init(&synth);
+	synth.titleID  = wad->titleID;
+	synth.stub     = wad->stub;
+	synth.contents = wad->contents;
+	synth.shared   = wad->shared;
+	synth.size     = gQuick ? wad->quickSize : wad->size;
+	synth.seed     = wad->titleID;
+
+	fprintf(stderr, "Generating %s...\n", path);
+
+	return (Synth_WriteWad(path, &synth) < 0) ? -1 : 0;
+}
+
+static s32 __ResetNand(void)
+{
+	char path[512];
+
+	snprintf(path, sizeof(path), "%s/nand", gWorkDir);
+	if (StandIn_SetRoot(path) < 0)
+		return -1;
+
+	StandIn_Remove("/");
+	if (StandIn_SetRoot(path) < 0)
+		return -1;
+
+	/* Like switching NAND devices on a console */
+	Title_FlushCaches();
+	Wad_FlushPolicy();
+
+	/* System Menu 4.3U on IOS80, so IOS can be uninstalled */
+	return StandIn_SeedSystem(513, 80, "USA");
+}
+
+/* Runs a batch the way the menu does: one WAD after the other, in order,
+ * with the next one read while the current one installs */
+static s32 __RunBatch(const char* const names[], bool install, u64* bytes, u32* failed)
+{
+	char path[512], next[512];
+	u32 count = 0;
+
+	while (count < MAX_BATCH && names[count])
+		count++;
+
+	*bytes = 0;
+	*failed = 0;
+
+	for (u32 i = 0; i < count; i++)
+	{
+		/* Uninstall in reverse so IOS go last */
+		const BenchWad* wad = __FindWad(names[install ? i : count - 1 - i]);
+		struct stat st;
+		s32 ret;
+
+		__WadPath(path, sizeof(path), wad);
+
+		if (install)
+		{
+			bool more = gPrefetch && i + 1 < count;
+			if (more)
+				__WadPath(next, sizeof(next), __FindWad(names[i + 1]));
+
+			ret = Wad_InstallFile(path, more ? next : NULL);
+		}
+		else
+		{
+			FILE* fp = fopen(path, "rb");
+			if (!fp)
+			{
+				(*failed)++;
+				continue;
+			}
+
+			ret = Wad_Uninstall(fp);
+			fclose(fp);
+		}
+
+		if (ret < 0)
+		{
+			fprintf(stderr, "  %s: %s (%d)\n", wad->name, wad_strerror(ret), ret);
+			(*failed)++;
+		}
+
+		if (!stat(path, &st))
+			*bytes += st.st_size;
+	}
+
+	Wad_DropPrefetch();
+
+	return count;
+}
+
+static void __Measure(const BenchScenario* scenario, const char* op, u32 run)
+{
+	bool install = !strcmp(op, "install");
+	StandInStats es;
+	StandInHeap heap;
+	WadPipeStats pipe;
+	ArenaStats arena;
+	u64 bytes;
+	u32 failed;
+
+	WadPipe_ResetStats();
+	Wad_ResetArenaStats();
+	StandIn_ResetStats();
+	StandIn_ResetHeapPeak();
+
+	__Silence(true);
+
+	u64 start = gettime();
+	s32 count = __RunBatch(scenario->wads, install, &bytes, &failed);
+	u64 usec = diff_usec(start, gettime());
+
+	__Silence(false);
+
+	WadPipe_GetStats(&pipe);
+	StandIn_GetStats(&es);
+	StandIn_GetHeap(&heap);
+	Wad_GetArenaStats(&arena);
+
+	u64 esTotal = es.lookupTime + es.ticketTime + es.titleStartTime + es.contentTime + es.titleFinishTime + es.deleteTime;
+	s64 other = (s64)usec - (s64)esTotal - (s64)pipe.stallTime;
+	double seconds = usec / 1000000.0;
+	double mbps = seconds > 0 ? (bytes / 1048576.0) / seconds : 0;
+
+	fprintf(gOut,
+		"{\"type\":\"result\",\"scenario\":\"%s\",\"op\":\"%s\",\"run\":%u,\"wads\":%d,\"failed\":%u,\"prefetch\":%s,"
+		"\"bytes\":%llu,\"content_bytes\":%llu,\"contents\":%u,\"usec\":%llu,\"mbps\":%.2f,"
+		"\"phases\":{\"es_lookup\":%llu,\"es_ticket\":%llu,\"es_title_start\":%llu,\"es_content\":%llu,"
+		"\"es_title_finish\":%llu,\"es_delete\":%llu,\"pipe_read\":%llu,\"pipe_write\":%llu,\"pipe_stall\":%llu,\"pipe_verify\":%llu,\"other\":%lld},"
+		"\"pipe\":{\"depth\":%u,\"blocks\":%u,\"overlapped\":%u,\"reader_stalls\":%u,\"writer_stalls\":%u},"
+		"\"arena\":{\"size\":%u,\"peak\":%u,\"padding\":%u,\"allocs\":%u,\"resets\":%u,\"spills\":%u,\"spill_bytes\":%u},"
+		"\"peak_heap\":%llu,\"allocs\":%u}\n",
+		scenario->name, op, run, count, failed, (install && gPrefetch) ? "true" : "false",
+		(unsigned long long)bytes, (unsigned long long)es.contentBytes, es.contents, (unsigned long long)usec, mbps,
+		(unsigned long long)es.lookupTime, (unsigned long long)es.ticketTime, (unsigned long long)es.titleStartTime,
+		(unsigned long long)es.contentTime, (unsigned long long)es.titleFinishTime, (unsigned long long)es.deleteTime,
+		(unsigned long long)pipe.readTime, (unsigned long long)pipe.writeTime, (unsigned long long)pipe.stallTime,
+		(unsigned long long)pipe.verifyTime, (long long)other,
+		pipe.depth, pipe.blocks, pipe.overlapped, pipe.readerStalls, pipe.writerStalls,
+		arena.size, arena.peak, arena.padding, arena.allocs, arena.resets, arena.spills, arena.spillBytes,
+		(unsigned long long)heap.peak, heap.allocs);
+	fflush(gOut);
+
+	fprintf(stderr, "  %-10s %-9s run %u: %8.1f ms %9.2f MB/s  peak heap %llu KiB%s\n",
+		scenario->name, op, run, usec / 1000.0, mbps, (unsigned long long)heap.peak >> 10, failed ? "  FAILED" : "");
+}
+
+static s32 __RunScenario(const BenchScenario* scenario, u32 runs)
+{
+	u64 bytes;
+	u32 failed;
+
+	for (u32 i = 0; i < MAX_BATCH && scenario->setup[i]; i++)
+	{
+		if (__Generate(__FindWad(scenario->setup[i])) < 0)
+			return -1;
+	}
+
+	for (u32 i = 0; i < MAX_BATCH && scenario->wads[i]; i++)
+	{
+		if (__Generate(__FindWad(scenario->wads[i])) < 0)
+			return -1;
+	}
+
+	for (u32 run = 1; run <= runs; run++)
+	{
+		if (__ResetNand() < 0)
+			return -1;
+
+		__Silence(true);
+		__RunBatch(scenario->setup, true, &bytes, &failed);
+		__Silence(false);
+
+		if (failed)
+			return -1;
+
+		__Measure(scenario, "install", run);
+		__Measure(scenario, "uninstall", run);
+	}
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	const char* outPath = NULL;
+	u32 runs = 3;
+	int opt, ret = 0;
+
+	while ((opt = getopt(argc, argv, "w:o:d:r:qvVS")) != -1)
+	{
+		switch (opt)
+		{
+			case 'w': snprintf(gWorkDir, sizeof(gWorkDir), "%s", optarg); break;
+			case 'o': outPath = optarg; break;
+			case 'd': WadPipe_SetDepth(atoi(optarg)); break;
+			case 'r': runs = atoi(optarg); break;
+			case 'q': gQuick = true; break;
+			case 'v': gVerbose = true; break;
+			case 'V': Wad_SetVerify(true); break;
+			case 'S': gPrefetch = false; break;
+			default: __Usage();
+		}
+	}
+
+	char path[512];
+	snprintf(path, sizeof(path), "%s/wads", gWorkDir);
+	mkdir(gWorkDir, 0755);
+	mkdir(path, 0755);
+
+	gStdout = dup(STDOUT_FILENO);
+	gNull = open("/dev/null", O_WRONLY);
+
+	gOut = outPath ? fopen(outPath, "w") : fdopen(dup(gStdout), "w");
+	if (!gOut || gStdout < 0 || gNull < 0)
+	{
+		fprintf(stderr, "Can't open output\n");
+		return 1;
+	}
+
+	ES_GetBoot2Version(&boot2version);
+	Title_SetupCommonKeys();
+
+	fprintf(gOut, "{\"type\":\"config\",\"depth\":%u,\"block_size\":%u,\"stream_buffer\":%u,\"runs\":%u,\"quick\":%s}\n",
+		WadPipe_GetDepth(), BLOCK_SIZE, FSOP_STREAM_BUFFER_SIZE, runs, gQuick ? "true" : "false");
+
+	for (u32 i = 0; i < NUM_SCENARIOS; i++)
+	{
+		const BenchScenario* scenario = &gScenarios[i];
+		bool selected = (optind == argc);
+
+		for (int j = optind; j < argc && !selected; j++)
+			selected = !strcmp(argv[j], scenario->name);
+
+		if (!selected)
+			continue;
+
+		if (__RunScenario(scenario, runs) < 0)
+		{
+			fprintf(stderr, "%s: setup failed\n", scenario->name);
+			ret = 1;
+		}
+	}
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	fprintf(gOut, "{\"type\":\"summary\",\"max_rss_kib\":%ld}\n", usage.ru_maxrss);
+	fclose(gOut);
+
+	Wad_FreeArenas();
+	WadPipe_Deinit();
+
+	return ret;
+}
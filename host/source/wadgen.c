@@ -0,0 +1,59 @@
+/*
+ * wadgen - write a synthetic WAD.
+ *
+ *   wadgen [-t titleid] [-i ios] [-v version] [-n contents] [-s size]
+ *          [-S shared] [-k commonkey] [-x] [-r seed] out.wad
+ *
+ * -x writes an IOS stub. Sizes take K, M and G suffixes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "synth.h"
+
+static void __Usage(void)
+{
+	fprintf(stderr, "usage: wadgen [-t titleid] [-i ios] [-v version] [-n contents] [-s size] [-S shared] [-k commonkey] [-x] [-r seed] out.wad\n");
+	exit(2);
+}
+
+int main(int argc, char** argv)
+{
+	SynthWad wad;
+	int opt;
+
+	Synth_Init(&wad);
+
+	while ((opt = getopt(argc, argv, "t:i:v:n:s:S:k:xr:")) != -1)
+	{
+		switch (opt)
+		{
+			case 't': wad.titleID  = strtoull(optarg, NULL, 16); break;
+			case 'i': wad.ios      = atoi(optarg); break;
+			case 'v': wad.version  = strtoul(optarg, NULL, 0); break;
+			case 'n': wad.contents = atoi(optarg); break;
+			case 's': wad.size     = Synth_ParseSize(optarg); break;
+			case 'S': wad.shared   = atoi(optarg); break;
+			case 'x': wad.stub     = true; break;
+			case 'r': wad.seed     = strtoull(optarg, NULL, 0); break;
+			case 'k':
+				if (!Synth_ParseKey(optarg, wad.commonKey))
+					__Usage();
+				break;
+			default: __Usage();
+		}
+	}
+
+	if (argc - optind != 1)
+		__Usage();
+
+	if (Synth_WriteWad(argv[optind], &wad) < 0)
+	{
+		fprintf(stderr, "%s: can't write\n", argv[optind]);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,439 @@
+/*
+ * wadhost - run the WAD engine on a PC against a stand-in NAND.
+ *
+ *   wadhost [-n nandroot] [-k commonkey] [-d depth] [-s] [-V] [-i] [-S] [-x n] install|uninstall|verify|info|batch file.wad...
+ *
+ * The common key is given as 32 hex digits and defaults to all zeroes,
+ * which is what the synthetic WADs are encrypted with. -s gives the NAND a
+ * System Menu 4.3U running on IOS80 first, system titles can't be removed
+ * without one. -V checks content hashes while installing, verify only
+ * checks them and never touches the NAND, directories are searched for
+ * .wad files. info prints what each WAD holds, going through the folder's
+ * index like the WAD list does. batch installs everything given through the
+ * batch planner, IOS first; -S skips titles already installed with the
+ * same contents. A batch of a single folder keeps its journal there and
+ * resumes it when it was cut short; -x n quits before the nth install, as
+ * if the power went out.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#include "standin.h"
+#include "synth.h"
+#include "title.h"
+#include "sys.h"
+#include "wad.h"
+#include "wadpipe.h"
+#include "wadindex.h"
+#include "wadplan.h"
+#include "wadjournal.h"
+
+enum
+{
+	CMD_INSTALL,
+	CMD_UNINSTALL,
+	CMD_VERIFY,
+	CMD_INFO,
+	CMD_BATCH,
+};
+
+/* Stops a batch before the given WAD, see -x */
+static u32 gStopAfter = 0;
+
+static void __Usage(void)
+{
+	fprintf(stderr, "usage: wadhost [-n nandroot] [-k commonkey] [-d depth] [-s] [-V] [-i] [-S] [-x n] install|uninstall|verify|info|batch file.wad...\n");
+	exit(2);
+}
+
+static void __PrintInfo(const char* name, const WadInfo* info)
+{
+	printf("%s: %016llx v%u", name, (unsigned long long)info->titleID, info->version);
+
+	if ((info->sysVersion >> 32) == 1)
+		printf(" IOS%u", (u32)info->sysVersion);
+
+	printf(", %u contents, %u bytes%s%s\n", info->numContents, info->contentSize,
+		(info->flags & WADINFO_STUB_IOS) ? ", stub" : "", (info->flags & WADINFO_VWII) ? ", vWii" : "");
+}
+
+/* next is read in the background while path installs, like in batches */
+static int __Run(const char* path, const char* next, int cmd)
+{
+	FILE* fp = NULL;
+
+	if (cmd != CMD_INSTALL)
+	{
+		fp = fopen(path, "rb");
+		if (!fp)
+		{
+			fprintf(stderr, "%s: can't open\n", path);
+			return 1;
+		}
+	}
+
+	if (cmd == CMD_INFO)
+	{
+		WadInfo info;
+		s32 ret = Wad_GetInfo(fp, &info);
+		fclose(fp);
+
+		if (ret < 0)
+		{
+			printf("%s: %s (%d)\n", path, wad_strerror(ret), ret);
+			return 1;
+		}
+
+		__PrintInfo(path, &info);
+		return 0;
+	}
+
+	printf("%s:\n", path);
+	WadPipe_ResetStats();
+
+	s32 ret;
+	switch (cmd)
+	{
+		case CMD_INSTALL:   ret = Wad_InstallFile(path, next); break;
+		case CMD_UNINSTALL: ret = Wad_Uninstall(fp); break;
+		default:            ret = Wad_Verify(fp);    break;
+	}
+
+	if (fp)
+		fclose(fp);
+
+	if (ret < 0)
+	{
+		printf("\n%s: %s (%d)\n", path, wad_strerror(ret), ret);
+		return 1;
+	}
+
+	if (cmd != CMD_UNINSTALL)
+	{
+		WadPipeStats stats;
+		WadPipe_GetStats(&stats);
+
+		printf("\n  depth %u, %u blocks, %llu bytes, %u overlapped, %u reader stalls, %u writer stalls, %llu us verifying\n",
+			stats.depth, stats.blocks, (unsigned long long)stats.bytes, stats.overlapped,
+			stats.readerStalls, stats.writerStalls, (unsigned long long)stats.verifyTime);
+	}
+
+	return 0;
+}
+
+/* Runs every .wad in a directory, in name order */
+static int __RunDir(const char* path, int cmd)
+{
+	struct dirent** list;
+	int failed = 0;
+
+	int n = scandir(path, &list, NULL, alphasort);
+	if (n < 0)
+		return __Run(path, NULL, cmd);
+
+	/* Folders are listed through their index */
+	fatFile* files = calloc(n, sizeof(fatFile));
+	u32 count = 0;
+
+	if (cmd == CMD_INFO && files)
+	{
+		WadIndex_Open(path);
+
+		for (int i = 0; i < n; i++)
+		{
+			const char* name = list[i]->d_name;
+			size_t len = strlen(name);
+
+			if (len > 4 && len < sizeof(files->filename) && !strcasecmp(name + len - 4, ".wad"))
+			{
+				strcpy(files[count].filename, name);
+				files[count++].iswad = true;
+			}
+		}
+
+		WadIndex_Prune(files, count);
+
+		for (u32 i = 0; i < count; i++)
+		{
+			WadInfo info;
+			s32 ret = WadIndex_Get(files[i].filename, &info);
+
+			if (ret < 0)
+			{
+				printf("%s: %s (%d)\n", files[i].filename, wad_strerror(ret), ret);
+				failed++;
+			}
+			else
+				__PrintInfo(files[i].filename, &info);
+		}
+
+		WadIndex_Close();
+
+		for (int i = 0; i < n; i++)
+			free(list[i]);
+
+		free(list);
+		free(files);
+		return failed;
+	}
+
+	free(files);
+
+	for (int i = 0; i < n; i++)
+	{
+		const char* name = list[i]->d_name;
+		size_t len = strlen(name);
+
+		if (len > 4 && !strcasecmp(name + len - 4, ".wad"))
+		{
+			char file[1024];
+			snprintf(file, sizeof(file), "%s/%s", path, name);
+			failed += __Run(file, NULL, cmd);
+		}
+
+		free(list[i]);
+	}
+
+	free(list);
+
+	return failed;
+}
+
+/* Adds a file, or the .wad files in a directory in name order */
+static void __Collect(const char* path, char*** files, u32* count)
+{
+	struct dirent** list;
+
+	int n = scandir(path, &list, NULL, alphasort);
+	if (n < 0)
+	{
+		*files = realloc(*files, (*count + 1) * sizeof(char*));
+		(*files)[(*count)++] = strdup(path);
+		return;
+	}
+
+	for (int i = 0; i < n; i++)
+	{
+		const char* name = list[i]->d_name;
+		size_t len = strlen(name);
+
+		if (len > 4 && !strcasecmp(name + len - 4, ".wad"))
+		{
+			char file[1024];
+			snprintf(file, sizeof(file), "%s/%s", path, name);
+
+			*files = realloc(*files, (*count + 1) * sizeof(char*));
+			(*files)[(*count)++] = strdup(file);
+		}
+
+		free(list[i]);
+	}
+
+	free(list);
+}
+
+static int __RunBatch(char** paths, int npaths)
+{
+	char** files = NULL;
+	u32 count = 0;
+	int failed = 0;
+	struct stat st;
+
+	/* A single folder keeps a journal, like the WAD list does */
+	const char* folder = (npaths == 1 && !stat(paths[0], &st) && S_ISDIR(st.st_mode)) ? paths[0] : NULL;
+
+	fatFile* resume;
+	u32 done, total;
+	s32 left = folder ? WadJournal_Load(folder, &resume, &done, &total) : 0;
+
+	if (left > 0)
+	{
+		printf("resuming: %u of %u done, %d left\n", done, total, left);
+
+		files = calloc(left, sizeof(char*));
+		for (count = 0; count < (u32)left; count++)
+		{
+			char file[1024];
+			snprintf(file, sizeof(file), "%s/%s", folder, resume[count].filename);
+			files[count] = strdup(file);
+		}
+
+		free(resume);
+	}
+	else
+	{
+		for (int i = 0; i < npaths; i++)
+			__Collect(paths[i], &files, &count);
+	}
+
+	WadPlanStep* plan = calloc(count, sizeof(WadPlanStep));
+
+	for (u32 i = 0; i < count; i++)
+	{
+		plan[i].item = i;
+		plan[i].mode = WADPLAN_INSTALL;
+		plan[i].ret  = -1;
+
+		FILE* fp = fopen(files[i], "rb");
+		if (fp)
+		{
+			plan[i].ret = Wad_GetInfo(fp, &plan[i].info);
+			fclose(fp);
+		}
+	}
+
+	WadPlan_Build(plan, count);
+
+	for (u32 i = 0; i < count; i++)
+	{
+		static const char* actions[] = { "install", "skip", "fail" };
+		printf("plan %u: %s %s%s\n", i + 1, actions[plan[i].action], files[plan[i].item], plan[i].batchIOS ? " (IOS from batch)" : "");
+	}
+
+	if (folder && WadJournal_Begin(folder, count) >= 0)
+	{
+		for (u32 i = 0; i < count; i++)
+		{
+			const char* name = strrchr(files[plan[i].item], '/') + 1;
+			WadJournal_Add(name, plan[i].mode, (plan[i].ret >= 0) ? &plan[i].info : NULL, plan[i].action == WADPLAN_SKIP);
+		}
+
+		Wad_SetProgress(WadJournal_Progress);
+	}
+
+	for (u32 i = 0; i < count; i++)
+	{
+		const char* path = files[plan[i].item];
+
+		if (plan[i].action == WADPLAN_SKIP)
+		{
+			printf("%s: already installed\n", path);
+			continue;
+		}
+
+		if (plan[i].action == WADPLAN_FAIL)
+		{
+			printf("%s: %s (%d)\n", path, wad_strerror(plan[i].ret), plan[i].ret);
+			WadJournal_SetState(i, WADJOURNAL_FAILED, plan[i].ret);
+			failed++;
+			continue;
+		}
+
+		/* Pull the plug, the journal is all that's left */
+		if (gStopAfter && !--gStopAfter)
+		{
+			printf("stopping before %s\n", path);
+			fflush(stdout);
+			_exit(3);
+		}
+
+		WadJournal_SetState(i, WADJOURNAL_RUNNING, 0);
+
+		/* Whatever installs next is read meanwhile */
+		const char* next = NULL;
+		for (u32 j = i + 1; j < count && !next; j++)
+		{
+			if (plan[j].action == WADPLAN_RUN)
+				next = files[plan[j].item];
+		}
+
+		if (__Run(path, next, CMD_INSTALL))
+		{
+			WadPlan_Failed(plan, count, i);
+			WadJournal_SetState(i, WADJOURNAL_FAILED, -1);
+			failed++;
+		}
+		else
+			WadJournal_SetState(i, WADJOURNAL_DONE, 0);
+	}
+
+	Wad_SetProgress(NULL);
+	WadJournal_End();
+	Wad_DropPrefetch();
+
+	for (u32 i = 0; i < count; i++)
+		free(files[i]);
+
+	free(files);
+	free(plan);
+
+	return failed;
+}
+
+int main(int argc, char** argv)
+{
+	const char* root = "nand";
+	u8 key[16] = {};
+	bool seed = false;
+	int cmd, opt, failed = 0;
+
+	while ((opt = getopt(argc, argv, "n:k:d:sViSx:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'n': root = optarg; break;
+			case 'd': WadPipe_SetDepth(atoi(optarg)); break;
+			case 's': seed = true; break;
+			case 'V': Wad_SetVerify(true); break;
+			case 'i': Wad_SetSkipIdentical(true); break;
+			case 'S': WadPlan_SetSkipInstalled(true); break;
+			case 'x': gStopAfter = atoi(optarg); break;
+			case 'k':
+				if (!Synth_ParseKey(optarg, key))
+					__Usage();
+				break;
+			default: __Usage();
+		}
+	}
+
+	if (argc - optind < 2)
+		__Usage();
+
+	if (!strcmp(argv[optind], "install"))
+		cmd = CMD_INSTALL;
+	else if (!strcmp(argv[optind], "uninstall"))
+		cmd = CMD_UNINSTALL;
+	else if (!strcmp(argv[optind], "verify"))
+		cmd = CMD_VERIFY;
+	else if (!strcmp(argv[optind], "info"))
+		cmd = CMD_INFO;
+	else if (!strcmp(argv[optind], "batch"))
+		cmd = CMD_BATCH;
+	else
+		__Usage();
+
+	if (StandIn_SetRoot(root) < 0)
+	{
+		fprintf(stderr, "Can't use NAND root %s\n", root);
+		return 1;
+	}
+
+	if (seed && StandIn_SeedSystem(513, 80, "USA") < 0)
+	{
+		fprintf(stderr, "Can't set up a System Menu in %s\n", root);
+		return 1;
+	}
+
+	StandIn_SetCommonKey(key);
+	ES_GetBoot2Version(&boot2version);
+	Title_SetupCommonKeys();
+
+	if (cmd == CMD_BATCH)
+		failed = __RunBatch(argv + optind + 1, argc - optind - 1);
+	else
+	{
+		for (int i = optind + 1; i < argc; i++)
+			failed += __RunDir(argv[i], cmd);
+	}
+
+	Wad_FreeArenas();
+	WadPipe_Deinit();
+
+	return failed ? 1 : 0;
+}
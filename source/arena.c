@@ -0,0 +1,151 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ogcsys.h>
+
+#include "arena.h"
+#include "utils.h"
+#include "malloc.h"
+
+/* No block to grow or pop */
+#define ARENA_NO_BLOCK	0xFFFFFFFF
+
+/* Arenas aren't locked, each one belongs to one thread at a time */
+
+s32 Arena_Init(Arena* arena, u32 size)
+{
+	memset(arena, 0, sizeof(Arena));
+	arena->last = arena->prev = ARENA_NO_BLOCK;
+
+	/* 64 byte aligned, so an aligned offset is an aligned address */
+	size = round_up(size, 64);
+
+	arena->base = memalign64(size);
+	if (!arena->base)
+		return -1;
+
+	arena->stats.size = size;
+	return 0;
+}
+
+void Arena_Destroy(Arena* arena)
+{
+	free(arena->base);
+
+	memset(arena, 0, sizeof(Arena));
+	arena->last = arena->prev = ARENA_NO_BLOCK;
+}
+
+static bool __Arena_Owns(const Arena* arena, const void* ptr)
+{
+	const u8* p = ptr;
+
+	return arena->base && p >= arena->base && p < arena->base + arena->stats.size;
+}
+
+static void __Arena_SetUsed(Arena* arena, u32 used)
+{
+	arena->stats.used = used;
+
+	if (used > arena->stats.peak)
+		arena->stats.peak = used;
+}
+
+/* Alignment is 32 or 64 bytes, anything else is taken as 32 */
+void* Arena_Alloc(Arena* arena, u32 size, u32 align)
+{
+	align = (align == 64) ? 64 : 32;
+
+	u32 start = round_up(arena->stats.used, align);
+
+	arena->stats.allocs++;
+
+	/* Doesn't fit, or never got its memory, the heap still works */
+	if (!arena->base || start > arena->stats.size || size > arena->stats.size - start)
+	{
+		void* ptr = (align == 64) ? memalign64(size) : memalign32(size);
+		if (ptr)
+		{
+			arena->stats.spills++;
+			arena->stats.spillBytes += size;
+		}
+
+		return ptr;
+	}
+
+	arena->stats.padding += start - arena->stats.used;
+	arena->prev = arena->last;
+	arena->last = start;
+	__Arena_SetUsed(arena, start + size);
+
+	return arena->base + start;
+}
+
+/* Like realloc, the newest block grows in place */
+void* Arena_Grow(Arena* arena, void* ptr, u32 oldSize, u32 size)
+{
+	if (!ptr)
+		return Arena_Alloc(arena, size, 32);
+
+	if (__Arena_Owns(arena, ptr) && (u8*)ptr == arena->base + arena->last && size <= arena->stats.size - arena->last)
+	{
+		__Arena_SetUsed(arena, arena->last + size);
+		return ptr;
+	}
+
+	void* out = Arena_Alloc(arena, size, 32);
+	if (!out)
+		return NULL;
+
+	memcpy(out, ptr, (oldSize < size) ? oldSize : size);
+	Arena_Free(arena, ptr);
+
+	return out;
+}
+
+/* Heap blocks are freed, the newest arena block is handed back, any other
+ * arena block waits for the reset */
+void Arena_Free(Arena* arena, void* ptr)
+{
+	if (!ptr)
+		return;
+
+	if (!__Arena_Owns(arena, ptr))
+	{
+		free(ptr);
+		return;
+	}
+
+	if ((u8*)ptr == arena->base + arena->last)
+	{
+		arena->stats.used = arena->last;
+		arena->last = arena->prev;
+		arena->prev = ARENA_NO_BLOCK;
+	}
+}
+
+/* Everything handed out so far is gone, heap blocks have to be freed first */
+void Arena_Reset(Arena* arena)
+{
+	arena->stats.used    = 0;
+	arena->stats.padding = 0;
+	arena->stats.resets++;
+	arena->last = arena->prev = ARENA_NO_BLOCK;
+}
+
+void Arena_GetStats(const Arena* arena, ArenaStats* out)
+{
+	*out = arena->stats;
+}
+
+/* Totals over several arenas, the peak is the sum of the peaks */
+void Arena_AddStats(ArenaStats* sum, const ArenaStats* stats)
+{
+	sum->size       += stats->size;
+	sum->used       += stats->used;
+	sum->peak       += stats->peak;
+	sum->padding    += stats->padding;
+	sum->allocs     += stats->allocs;
+	sum->resets     += stats->resets;
+	sum->spills     += stats->spills;
+	sum->spillBytes += stats->spillBytes;
+}
@@ -0,0 +1,49 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <gctypes.h>
+
+/* Usage, kept across resets except where noted */
+typedef struct
+{
+	u32 size;
+	u32 used;
+
+	/* Most ever in use at once */
+	u32 peak;
+
+	/* Lost to alignment since the last reset */
+	u32 padding;
+
+	u32 allocs;
+	u32 resets;
+
+	/* Requests that didn't fit and went to the heap instead */
+	u32 spills;
+	u32 spillBytes;
+} ArenaStats;
+
+/* Bump allocator, blocks are freed all at once by a reset */
+typedef struct
+{
+	u8* base;
+
+	/* Start of the newest block, it alone can grow or be popped, and of
+	 * the one before, which is the newest again once that's popped */
+	u32 last;
+	u32 prev;
+
+	ArenaStats stats;
+} Arena;
+
+/* Prototypes */
+s32   Arena_Init(Arena* arena, u32 size);
+void  Arena_Destroy(Arena* arena);
+void* Arena_Alloc(Arena* arena, u32 size, u32 align);
+void* Arena_Grow(Arena* arena, void* ptr, u32 oldSize, u32 size);
+void  Arena_Free(Arena* arena, void* ptr);
+void  Arena_Reset(Arena* arena);
+void  Arena_GetStats(const Arena* arena, ArenaStats* out);
+void  Arena_AddStats(ArenaStats* sum, const ArenaStats* stats);
+
+#endif
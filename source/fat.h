@@ -18,6 +18,8 @@ typedef struct
 	bool iself;
 	bool iswad;
 	size_t fsize;
+	/* fsize is valid, looked up lazily */
+	bool sized;
 } fatFile;
 
 /* Prototypes */
@@ -74,3 +74,79 @@ s32 FSOPReadOpenFileA(FILE* fp, void** buffer, u32 offset, u32 length)
 
 	return ret;
 }
+
+void FSOPStreamAttach(FSOPStream* stream, FILE* fp, void* buffer, u32 bufferSize)
+{
+	memset(stream, 0, sizeof(FSOPStream));
+
+	stream->buffer = buffer;
+
+	stream->fp = fp;
+	stream->bufferSize = bufferSize;
+	stream->filePos = ftell(fp);
+}
+
+/* The buffer stays the caller's */
+void FSOPStreamClose(FSOPStream* stream)
+{
+	stream->buffer = NULL;
+	stream->bufferLen = 0;
+}
+
+static u32 __FSOPStreamFill(FSOPStream* stream, void* buffer, u32 offset, u32 length)
+{
+	/* Only seek if we are not already there */
+	if (stream->filePos != offset)
+	{
+		if (fseek(stream->fp, offset, SEEK_SET) < 0)
+			return 0;
+
+		stream->filePos = offset;
+		stream->seeks++;
+	}
+
+	size_t read = fread(buffer, 1, length, stream->fp);
+
+	stream->filePos += read;
+	stream->bytes += read;
+	stream->reads++;
+
+	return read;
+}
+
+s32 FSOPStreamRead(FSOPStream* stream, void* buffer, u32 offset, u32 length)
+{
+	u8* out = buffer;
+
+	while (length)
+	{
+		/* Serve what we can from the buffer */
+		if (offset >= stream->bufferStart && offset < stream->bufferStart + stream->bufferLen)
+		{
+			u32 pos = offset - stream->bufferStart;
+			u32 size = stream->bufferLen - pos;
+			if (size > length)
+				size = length;
+
+			memcpy(out, stream->buffer + pos, size);
+
+			out += size;
+			offset += size;
+			length -= size;
+			continue;
+		}
+
+		/* Large reads bypass the buffer */
+		if (length >= stream->bufferSize)
+			return __FSOPStreamFill(stream, out, offset, length) == length;
+
+		/* Refill */
+		stream->bufferStart = offset;
+		stream->bufferLen = __FSOPStreamFill(stream, stream->buffer, offset, stream->bufferSize);
+
+		if (!stream->bufferLen)
+			return 0;
+	}
+
+	return 1;
+}
@@ -15,4 +15,30 @@ void FSOPMakeFolder(const char* path);
 s32 FSOPReadOpenFile(FILE* fp, void* buffer, u32 offset, u32 length);
 s32 FSOPReadOpenFileA(FILE* fp, void** buffer, u32 offset, u32 length);
 
+/* Buffered forward reader */
+#define FSOP_STREAM_BUFFER_SIZE	0x40000
+
+typedef struct
+{
+	FILE* fp;
+
+	/* Read-ahead buffer and the file range it holds */
+	u8* buffer;
+	u32 bufferSize;
+	u32 bufferStart;
+	u32 bufferLen;
+
+	/* Where the underlying file currently is */
+	u32 filePos;
+
+	/* Statistics */
+	u32 seeks;
+	u32 reads;
+	u64 bytes;
+} FSOPStream;
+
+void FSOPStreamAttach(FSOPStream* stream, FILE* fp, void* buffer, u32 bufferSize);
+void FSOPStreamClose(FSOPStream* stream);
+s32 FSOPStreamRead(FSOPStream* stream, void* buffer, u32 offset, u32 length);
+
 #endif
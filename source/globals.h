@@ -14,6 +14,7 @@
 
 #define WM_CONFIG_FILE_PATH "/wad/wm_config.txt"
 #define WM_BACKGROUND_PATH "/wad/background.png"
+#define WM_PATCH_CACHE_PATH "/wad/wmpatch.bin"
 
 #define FAT_DEVICE_INDEX_INVALID -1
 #define NAND_DEVICE_INDEX_INVALID   -1
@@ -30,6 +31,15 @@ typedef struct
 	int cIOSVersion;
 	int fatDeviceIndex;
 	int nandDeviceIndex;
+	int pipelineDepth;
+	int verifyContents;
+	int skipInstalled;
+	int unattended;
+	int skipIdentical;
+	int patchCache;
+	int recordIOS;
+	int usbCache;
+	int usbReadAhead;
 	const char *smbuser;
 	const char *smbpassword;
 	const char *share;
@@ -17,39 +17,23 @@
 #include <string.h>
 
 #include "iospatch.h"
+#include "patchscan.h"
+#include "patchcache.h"
 
 #define MEM_REG_BASE 0xd8b4000
 #define MEM_PROT (MEM_REG_BASE + 0x20a)
 
+/* IOS memory, from the start of MEM2 as the loader left it */
+#define IOS_MEM_START ((u8*)(uintptr_t)*((u32*)0x80003134))
+#define IOS_MEM_END ((u8*)0x94000000)
+
+/* Where IOS memory is recorded for the host test bench, nowhere by default */
+static char record_dir[128];
+
 static void disable_memory_protection() {
 	write32(MEM_PROT, read32(MEM_PROT) & 0x0000FFFF);
 }
 
-static u32 apply_patch(char *name, const u8 *old, u32 old_size, const u8 *patch, u32 patch_size, u32 patch_offset) {
-	u8 *ptr_start = (u8*)*((u32*)0x80003134), *ptr_end = (u8*)0x94000000;
-	u32 found = 0;
-//	printf("    Patching %-30s", name);
-	u8 *location = NULL;
-	while (ptr_start < (ptr_end - patch_size)) {
-		if (!memcmp(ptr_start, old, old_size)) {
-			found++;
-			location = ptr_start + patch_offset;
-			u8 *start = location;
-			u32 i;
-			for (i = 0; i < patch_size; i++) {
-				*location++ = patch[i];
-			}
-			DCFlushRange((u8 *)(((u32)start) >> 5 << 5), (patch_size >> 5 << 5) + 64);
-			ICInvalidateRange((u8 *)(((u32)start) >> 5 << 5), (patch_size >> 5 << 5) + 64);
-		}
-		ptr_start++;
-	}
-//	if (found)
-//		printf(" patched\n");
-//	else
-//		printf(" not patched\n");
-	return found;
-}
 /*
 static const u8 di_readlimit_old[] = {
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -85,34 +69,190 @@ const u8 Kill_AntiSysTitleInstallv3_pt2_patch[] = { 0x46, 0xC0, 0x33, 0x06, 0x42
 const u8 Kill_AntiSysTitleInstallv3_pt3_old[] = { 0x68, 0xFB, 0x2B, 0x00, 0xDB, 0x01 };
 const u8 Kill_AntiSysTitleInstallv3_pt3_patch[] = { 0x68, 0xFB, 0x2B, 0x00, 0xDB, 0x10 };
 
+static const IOSPatch patches[] = {
+	//{ "di_readlimit", di_readlimit_old, sizeof(di_readlimit_old), di_readlimit_patch, sizeof(di_readlimit_patch), 12, IOSPATCH_SET_ES },
+	{ "isfs_permissions", isfs_permissions_old, sizeof(isfs_permissions_old), isfs_permissions_patch, sizeof(isfs_permissions_patch), 0, IOSPATCH_SET_ES },
+	//{ "es_setuid", setuid_old, sizeof(setuid_old), setuid_patch, sizeof(setuid_patch), 0, IOSPATCH_SET_ES },
+	//{ "es_identify", es_identify_old, sizeof(es_identify_old), es_identify_patch, sizeof(es_identify_patch), 2, IOSPATCH_SET_ES },
+	{ "hash_check", hash_old, sizeof(hash_old), hash_patch, sizeof(hash_patch), 1, IOSPATCH_SET_ES },
+	{ "new_hash_check", new_hash_old, sizeof(new_hash_old), hash_patch, sizeof(hash_patch), 1, IOSPATCH_SET_ES },
+	{ "ES_TitleVersionCheck", ES_TitleVersionCheck_old, sizeof(ES_TitleVersionCheck_old), ES_TitleVersionCheck_patch, sizeof(ES_TitleVersionCheck_patch), 0, IOSPATCH_SET_ES },
+	{ "ES_TitleDeleteCheck", ES_TitleDeleteCheck_old, sizeof(ES_TitleDeleteCheck_old), ES_TitleDeleteCheck_patch, sizeof(ES_TitleDeleteCheck_patch), 0, IOSPATCH_SET_ES },
+	{ "Kill_AntiSysTitleInstallv3_pt1", Kill_AntiSysTitleInstallv3_pt1_old, sizeof(Kill_AntiSysTitleInstallv3_pt1_old), Kill_AntiSysTitleInstallv3_pt1_patch, sizeof(Kill_AntiSysTitleInstallv3_pt1_patch), 0, IOSPATCH_SET_VWII },
+	{ "Kill_AntiSysTitleInstallv3_pt2", Kill_AntiSysTitleInstallv3_pt2_old, sizeof(Kill_AntiSysTitleInstallv3_pt2_old), Kill_AntiSysTitleInstallv3_pt2_patch, sizeof(Kill_AntiSysTitleInstallv3_pt2_patch), 0, IOSPATCH_SET_VWII },
+	{ "Kill_AntiSysTitleInstallv3_pt3", Kill_AntiSysTitleInstallv3_pt3_old, sizeof(Kill_AntiSysTitleInstallv3_pt3_old), Kill_AntiSysTitleInstallv3_pt3_patch, sizeof(Kill_AntiSysTitleInstallv3_pt3_patch), 0, IOSPATCH_SET_VWII },
+	//{ "set_ahbprot", check_tmd_old, sizeof(check_tmd_old), check_tmd_patch, sizeof(check_tmd_patch), 6, IOSPATCH_SET_AHBPROT },
+	{ "es_set_ahbprot", es_set_ahbprot_old, sizeof(es_set_ahbprot_old), es_set_ahbprot_patch, sizeof(es_set_ahbprot_patch), 25, IOSPATCH_SET_AHBPROT },
+};
+
+#define NUM_PATCHES (sizeof(patches) / sizeof(patches[0]))
+
+const IOSPatch *IOSPATCH_GetPatches(u32 *count) {
+	*count = NUM_PATCHES;
+	return patches;
+}
+
+static u32 write_patch(u8 *mem, u32 size, u32 offset, const IOSPatch *patch) {
+	if (offset + patch->patchOffset + patch->patchSize > size)
+		return 0;
+
+	u8 *start = mem + offset + patch->patchOffset;
+	memcpy(start, patch->patch, patch->patchSize);
+
+	DCFlushRange((u8 *)(((uintptr_t)start) >> 5 << 5), (patch->patchSize >> 5 << 5) + 64);
+	ICInvalidateRange((u8 *)(((uintptr_t)start) >> 5 << 5), (patch->patchSize >> 5 << 5) + 64);
+
+	return patch->patchSize;
+}
+
+/* Finds every signature of the given sets in one pass, then patches them.
+ * Hits and patched bytes are optional. Returns the number of matches. */
+u32 IOSPATCH_ApplyRange(u8 *mem, u32 size, u32 sets, PatchScanHits *hits, u32 *bytes) {
+	PatchScanHits found[NUM_PATCHES];
+	u32 written = 0;
+
+	if (!hits)
+		hits = found;
+
+	s32 count = PatchScan_Find(mem, size, patches, NUM_PATCHES, sets, hits);
+	if (count < 0)
+		count = 0;
+
+	for (u32 i = 0; i < NUM_PATCHES; i++) {
+		const IOSPatch *patch = &patches[i];
+		u32 kept = (hits[i].hits < PATCHSCAN_MAX_OFFSETS) ? hits[i].hits : PATCHSCAN_MAX_OFFSETS;
+
+		for (u32 j = 0; j < kept; j++)
+			written += write_patch(mem, size, hits[i].offsets[j], patch);
+
+		/* More than the scan kept offsets for, the rest the slow way */
+		if (hits[i].hits > kept) {
+			for (u32 pos = hits[i].offsets[kept - 1] + 1; pos + patch->oldSize <= size; pos++) {
+				if (!memcmp(mem + pos, patch->old, patch->oldSize))
+					written += write_patch(mem, size, pos, patch);
+			}
+		}
+	}
+
+	if (bytes)
+		*bytes = written;
+
+	return count;
+}
+
+/* Offsets from an earlier boot, if the signature is still at every one */
+static bool apply_cached(u8 *mem, u32 size, const PatchCacheEntry *entry, u32 *bytes) {
+	u32 written = 0;
+
+	for (u32 i = 0; i < entry->count; i++) {
+		if (entry->patch[i] >= NUM_PATCHES)
+			return false;
+
+		const IOSPatch *patch = &patches[entry->patch[i]];
+
+		if (entry->offset[i] > size - patch->oldSize || memcmp(mem + entry->offset[i], patch->old, patch->oldSize))
+			return false;
+	}
+
+	for (u32 i = 0; i < entry->count; i++)
+		written += write_patch(mem, size, entry->offset[i], &patches[entry->patch[i]]);
+
+	if (bytes)
+		*bytes = written;
+
+	return true;
+}
+
+/* Patch offsets are fixed for an IOS revision, so they are looked up before
+ * scanning. A scan that found anything is remembered for the next boot. */
+u32 IOSPATCH_ApplyCached(u8 *mem, u32 size, u32 sets, u16 ios, u16 revision, u32 *bytes, bool *cached) {
+	PatchScanHits hits[NUM_PATCHES];
+	PatchCacheEntry entry;
+
+	if (cached)
+		*cached = false;
+
+	if (PatchCache_Find(ios, revision, sets, size, &entry) && apply_cached(mem, size, &entry, bytes)) {
+		if (cached)
+			*cached = true;
+
+		return entry.count;
+	}
+
+	u32 count = IOSPATCH_ApplyRange(mem, size, sets, hits, bytes);
+
+	/* Nothing found may mean already patched, that's not worth keeping */
+	if (!count || count > PATCHCACHE_MAX_HITS)
+		return count;
+
+	memset(&entry, 0, sizeof(entry));
+	entry.ios      = ios;
+	entry.revision = revision;
+	entry.sets     = sets;
+	entry.size     = size;
+
+	for (u32 i = 0; i < NUM_PATCHES; i++) {
+		if (hits[i].hits > PATCHSCAN_MAX_OFFSETS)
+			return count;
+
+		for (u32 j = 0; j < hits[i].hits; j++) {
+			entry.patch[entry.count]  = i;
+			entry.offset[entry.count] = hits[i].offsets[j];
+			entry.count++;
+		}
+	}
+
+	PatchCache_Store(&entry);
+	return count;
+}
+
 u32 IOSPATCH_AHBPROT() {
 	if (AHBPROT_DISABLED) {
 		write32(MEM_PROT, read32(MEM_PROT) & 0x0000FFFF);
-		//return apply_patch("set_ahbprot", check_tmd_old, sizeof(check_tmd_old), check_tmd_patch, sizeof(check_tmd_patch), 6);
-		return apply_patch("es_set_ahbprot", es_set_ahbprot_old, sizeof(es_set_ahbprot_old), es_set_ahbprot_patch, sizeof(es_set_ahbprot_patch), 25);
+		return IOSPATCH_ApplyRange(IOS_MEM_START, IOS_MEM_END - IOS_MEM_START, IOSPATCH_SET_AHBPROT, NULL, NULL);
 	}
 	return 0;
 }
 
+void IOSPATCH_SetRecordDir(const char *dir) {
+	snprintf(record_dir, sizeof(record_dir), "%s", dir ? dir : "");
+}
+
+/* IOS memory as it was before patching, once per IOS revision */
+static void record_image(const u8 *mem, u32 size, u16 ios, u16 revision) {
+	char path[160];
+
+	if (!record_dir[0])
+		return;
+
+	snprintf(path, sizeof(path), "%sios%u-%u.bin", record_dir, ios, revision);
+
+	FILE *fp = fopen(path, "rb");
+	if (fp) {
+		fclose(fp);
+		return;
+	}
+
+	fp = fopen(path, "wb");
+	if (!fp)
+		return;
+
+	fwrite(mem, 1, size, fp);
+	fclose(fp);
+}
+
 u32 IOSPATCH_Apply() {
 	u32 count = 0;
 	if (AHBPROT_DISABLED) {
+		u32 sets = IOSPATCH_SET_ES;
+
 		disable_memory_protection();
-		//count += apply_patch("di_readlimit", di_readlimit_old, sizeof(di_readlimit_old), di_readlimit_patch, sizeof(di_readlimit_patch), 12);
-		count += apply_patch("isfs_permissions", isfs_permissions_old, sizeof(isfs_permissions_old), isfs_permissions_patch, sizeof(isfs_permissions_patch), 0);
-		//count += apply_patch("es_setuid", setuid_old, sizeof(setuid_old), setuid_patch, sizeof(setuid_patch), 0);
-		//count += apply_patch("es_identify", es_identify_old, sizeof(es_identify_old), es_identify_patch, sizeof(es_identify_patch), 2);
-		count += apply_patch("hash_check", hash_old, sizeof(hash_old), hash_patch, sizeof(hash_patch), 1);
-		count += apply_patch("new_hash_check", new_hash_old, sizeof(new_hash_old), hash_patch, sizeof(hash_patch), 1);
-		count += apply_patch("ES_TitleVersionCheck", ES_TitleVersionCheck_old, sizeof(ES_TitleVersionCheck_old), ES_TitleVersionCheck_patch, sizeof(ES_TitleVersionCheck_patch), 0);
-		count += apply_patch("ES_TitleDeleteCheck", ES_TitleDeleteCheck_old, sizeof(ES_TitleDeleteCheck_old), ES_TitleDeleteCheck_patch, sizeof(ES_TitleDeleteCheck_patch), 0);
 
 		if((*(vu16*)0xCD8005A0 == 0xCAFE))
-		{
-			count += apply_patch("Kill_AntiSysTitleInstallv3_pt1", Kill_AntiSysTitleInstallv3_pt1_old, sizeof(Kill_AntiSysTitleInstallv3_pt1_old), Kill_AntiSysTitleInstallv3_pt1_patch, sizeof(Kill_AntiSysTitleInstallv3_pt1_patch), 0);
-			count += apply_patch("Kill_AntiSysTitleInstallv3_pt2", Kill_AntiSysTitleInstallv3_pt2_old, sizeof(Kill_AntiSysTitleInstallv3_pt2_old), Kill_AntiSysTitleInstallv3_pt2_patch, sizeof(Kill_AntiSysTitleInstallv3_pt2_patch), 0);
-			count += apply_patch("Kill_AntiSysTitleInstallv3_pt3", Kill_AntiSysTitleInstallv3_pt3_old, sizeof(Kill_AntiSysTitleInstallv3_pt3_old), Kill_AntiSysTitleInstallv3_pt3_patch, sizeof(Kill_AntiSysTitleInstallv3_pt3_patch), 0);
-		}
+			sets |= IOSPATCH_SET_VWII;
+
+		record_image(IOS_MEM_START, IOS_MEM_END - IOS_MEM_START, IOS_GetVersion(), IOS_GetRevision());
+		count = IOSPATCH_ApplyCached(IOS_MEM_START, IOS_MEM_END - IOS_MEM_START, sets, IOS_GetVersion(), IOS_GetRevision(), NULL, NULL);
 	}
 	return count;
 }
@@ -20,10 +20,23 @@ extern "C" {
 
 #include <gccore.h>
 
+#include "patchscan.h"
+
+#ifndef AHBPROT_DISABLED
 #define AHBPROT_DISABLED ((*(vu32*)0xcd800064 == 0xFFFFFFFF) ? 1 : 0)
+#endif
+
+/* Patch sets */
+#define IOSPATCH_SET_ES			(1 << 0)
+#define IOSPATCH_SET_VWII		(1 << 1)
+#define IOSPATCH_SET_AHBPROT	(1 << 2)
 
 u32 IOSPATCH_AHBPROT();
 u32 IOSPATCH_Apply();
+u32 IOSPATCH_ApplyRange(u8 *mem, u32 size, u32 sets, PatchScanHits *hits, u32 *bytes);
+u32 IOSPATCH_ApplyCached(u8 *mem, u32 size, u32 sets, u16 ios, u16 revision, u32 *bytes, bool *cached);
+const IOSPatch *IOSPATCH_GetPatches(u32 *count);
+void IOSPATCH_SetRecordDir(const char *dir);
 
 #ifdef __cplusplus
 }
@@ -4,6 +4,8 @@
 #include <malloc.h>
 #include <ogcsys.h>
 #include <ogc/pad.h>
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
 #include <wiilight.h>
 #include <wiidrc/wiidrc.h>
 #include <unistd.h>
@@ -23,6 +25,10 @@
 #include "iospatch.h"
 #include "appboot.h"
 #include "fileops.h"
+#include "wadindex.h"
+#include "wadplan.h"
+#include "wadjournal.h"
+#include "arena.h"
 #include "menu.h"
 
 /* NAND device list */
@@ -45,6 +51,7 @@ static bool gNeedPriiloaderOption = false;
 // Local prototypes: wiiNinja
 void WaitPrompt (char *prompt);
 u32 WaitButtons(void);
+u32 WaitButtonsTimeout(u32 frames);
 u32 Pad_GetButtons(void);
 void WiiLightControl (int state);
 
@@ -76,14 +83,91 @@ static int __Menu_EntryCmp(const void *p1, const void *p2)
         return strcasecmp(f1->filename, f2->filename);
 }
 
-static s32 __Menu_RetrieveList(char *inPath, fatFile **outbuf, u32 *outlen)
+/* Fills in a list entry, false for entries that aren't listed */
+static bool __Menu_ReadEntry(const char *inPath, struct dirent *ent, fatFile *file)
+{
+	bool isdir = false;
+	bool isdol = false;
+	bool iself = false;
+	bool iswad = false;
+
+	char tmpPath[MAX_FILE_PATH_LEN];
+
+	/* Hide entries that start with "._". I hate macOS */
+	if (!strncmp(ent->d_name, "._", 2))
+		return false;
+
+	/* Only stat when the filesystem doesn't tell us the type */
+	if (ent->d_type == DT_UNKNOWN)
+	{
+		snprintf(tmpPath, MAX_FILE_PATH_LEN, "%s/%s", inPath, ent->d_name);
+		isdir = FSOPFolderExists(tmpPath);  // wiiNinja
+	}
+	else
+		isdir = (ent->d_type == DT_DIR);
+
+	if (isdir)
+	{
+		// Keep "..", the previous directory, libfat doesn't list it at the root
+		if (strcmp (ent->d_name, ".") == 0)
+			return false;
+	}
+	else
+	{
+		const char* ext = strrchr(ent->d_name, '.');
+		if (!ext)
+			return false;
+
+		iswad = !strcasecmp(ext, ".wad");
+		isdol = !strcasecmp(ext, ".dol");
+		iself = !strcasecmp(ext, ".elf");
+
+		if (!(iswad || isdol || iself))
+			return false;
+	}
+
+	// Clear fatFile structure
+	memset(file, 0, sizeof(fatFile));
+
+	/* File name */
+	strcpy(file->filename, ent->d_name);
+
+	/* File stats, the size is looked up once the entry is shown */
+	file->isdir = isdir;
+	file->isdol = isdol;
+	file->iself = iself;
+	file->iswad = iswad;
+
+	return true;
+}
+
+/* File lists grow in place in one arena, a new folder starts it over */
+#define LIST_ARENA_SIZE	0x40000
+
+static Arena gListArena;
+
+static void __Menu_InitListArena(void)
+{
+	/* Lists go to the heap if this fails */
+	if (!gListArena.base)
+		Arena_Init(&gListArena, LIST_ARENA_SIZE);
+}
+
+static void __Menu_FreeList(fatFile **list)
+{
+	Arena_Free(&gListArena, *list);
+	Arena_Reset(&gListArena);
+	*list = NULL;
+}
+
+static s32 __Menu_RetrieveList(char *inPath, Arena *arena, fatFile **outbuf, u32 *outlen)
 {
 	fatFile     *buffer = NULL;
+	fatFile       *list = NULL;
 	DIR            *dir = NULL;
 	struct dirent  *ent = NULL;
 	u32             cnt = 0;
-
-	char tmpPath[MAX_FILE_PATH_LEN];
+	u32            size = 0;
 
 	/* Clear output values */
 	*outbuf = NULL;
@@ -97,92 +181,231 @@ static s32 __Menu_RetrieveList(char *inPath, fatFile **outbuf, u32 *outlen)
 	/* Get entries */
 	while ((ent = readdir(dir)) != NULL)
 	{
-		bool addFlag = false;
-		bool isdir = false;
-		bool isdol = false;
-		bool iself = false;
-		bool iswad = false;
-		size_t fsize = 0;
-
-		/* Hide entries that start with "._". I hate macOS */
-		if (!strncmp(ent->d_name, "._", 2))
+		/* Grow geometrically, big folders would realloc on every entry */
+		if (cnt == size)
+		{
+			size = size ? size * 2 : 64;
+
+			buffer = Arena_Grow(arena, list, cnt * sizeof(fatFile), size * sizeof(fatFile));
+			if (!buffer) // Reallocation failed. Why?
+			{
+				Arena_Free(arena, list);
+				closedir(dir);
+				return -997;
+			}
+			list = buffer;
+		}
+
+		if (__Menu_ReadEntry(inPath, ent, &list[cnt]))
+			cnt++;
+	}
+
+	/* Sort list */
+	qsort(list, cnt, sizeof(fatFile), __Menu_EntryCmp);
+
+	/* Close directory */
+	closedir(dir);
+
+	/* Set values */
+	*outbuf = list;
+	*outlen = cnt;
+
+	return 0;
+}
+
+/* Listing that keeps reading the directory in the background, so the first
+ * page shows up before a huge folder is read in full */
+enum
+{
+	LIST_THREAD_PRIORITY = 48,
+	LIST_THREAD_STACK    = 0x4000,
+	LIST_REFRESH_FRAMES  = 15,
+};
+
+static struct
+{
+	char path[MAX_FILE_PATH_LEN];
+	DIR *dir;
+
+	lwp_t   thread;
+	mutex_t lock;
+
+	/* Entries read but not merged into the list yet */
+	fatFile *pending;
+	u32 pendingCnt;
+	u32 pendingSize;
+
+	bool running;
+	bool done;
+	bool abort;
+} gLister = { .thread = LWP_THREAD_NULL, .lock = LWP_MUTEX_NULL };
+
+static void* __Menu_ListThread(__attribute__((unused)) void *arg)
+{
+	struct dirent *ent;
+	fatFile file;
+
+	while (!gLister.abort && (ent = readdir(gLister.dir)) != NULL)
+	{
+		if (!__Menu_ReadEntry(gLister.path, ent, &file))
 			continue;
 
-		snprintf(tmpPath, MAX_FILE_PATH_LEN, "%s/%s", inPath, ent->d_name);
-		if (FSOPFolderExists(tmpPath))  // wiiNinja
+		LWP_MutexLock(gLister.lock);
+
+		if (gLister.pendingCnt == gLister.pendingSize)
 		{
-			isdir = true;
-			// Add only the item ".." which is the previous directory
-			// AND if we're not at the root directory
-			if ((strcmp (ent->d_name, "..") == 0) && (strchr(inPath, '/') == strrchr(inPath, '/')))
-				addFlag = true;
-			else if (strcmp (ent->d_name, ".") != 0)
-				addFlag = true;
+			u32 size = gLister.pendingSize ? gLister.pendingSize * 2 : 64;
+			fatFile *pending = reallocarray(gLister.pending, size, sizeof(fatFile));
+
+			/* Out of memory, list what we have */
+			if (!pending)
+			{
+				LWP_MutexUnlock(gLister.lock);
+				break;
+			}
+
+			gLister.pending = pending;
+			gLister.pendingSize = size;
 		}
-		else
+
+		gLister.pending[gLister.pendingCnt++] = file;
+		LWP_MutexUnlock(gLister.lock);
+	}
+
+	closedir(gLister.dir);
+	gLister.dir = NULL;
+
+	LWP_MutexLock(gLister.lock);
+	gLister.done = true;
+	LWP_MutexUnlock(gLister.lock);
+
+	return NULL;
+}
+
+static void __Menu_StopList(void)
+{
+	if (!gLister.running)
+		return;
+
+	gLister.abort = true;
+	LWP_JoinThread(gLister.thread, NULL);
+	LWP_MutexDestroy(gLister.lock);
+
+	free(gLister.pending);
+	gLister.pending = NULL;
+	gLister.pendingCnt = gLister.pendingSize = 0;
+
+	gLister.thread  = LWP_THREAD_NULL;
+	gLister.lock    = LWP_MUTEX_NULL;
+	gLister.running = false;
+}
+
+static s32 __Menu_StartList(const char *inPath)
+{
+	__Menu_StopList();
+
+	snprintf(gLister.path, sizeof(gLister.path), "%s", inPath);
+	__Menu_InitListArena();
+
+	gLister.dir = opendir(inPath);
+	if (!gLister.dir)
+		return -1;
+
+	gLister.done  = false;
+	gLister.abort = false;
+
+	if (LWP_MutexInit(&gLister.lock, false) < 0)
+		goto err;
+
+	if (LWP_CreateThread(&gLister.thread, __Menu_ListThread, NULL, NULL, LIST_THREAD_STACK, LIST_THREAD_PRIORITY) < 0)
+	{
+		LWP_MutexDestroy(gLister.lock);
+		gLister.lock = LWP_MUTEX_NULL;
+		goto err;
+	}
+
+	gLister.running = true;
+	return 0;
+
+err:
+	closedir(gLister.dir);
+	gLister.dir = NULL;
+	return -1;
+}
+
+/* Merges what the lister found so far into the sorted list, true once the
+ * whole directory is in. The selection stays on the same entry, unless
+ * it's at the top. */
+static bool __Menu_MergeList(fatFile **list, u32 *cnt, int *selected, int *start)
+{
+	if (!gLister.running)
+		return true;
+
+	LWP_MutexLock(gLister.lock);
+	fatFile *batch = gLister.pending;
+	u32 n = gLister.pendingCnt;
+	bool done = gLister.done;
+
+	gLister.pending = NULL;
+	gLister.pendingCnt = gLister.pendingSize = 0;
+	LWP_MutexUnlock(gLister.lock);
+
+	if (n)
+	{
+		qsort(batch, n, sizeof(fatFile), __Menu_EntryCmp);
+
+		/* The list is the newest block in its arena, so it grows in place
+		 * and both are merged from the back, without a third copy */
+		fatFile *merged = Arena_Grow(&gListArena, *list, *cnt * sizeof(fatFile), (*cnt + n) * sizeof(fatFile));
+		if (merged)
 		{
-			if (strrchr(ent->d_name, '.'))
+			u32 i = *cnt, j = n, k = *cnt + n, before = 0;
+
+			while (j > 0)
 			{
-				if (!strcasecmp(strrchr(ent->d_name, '.'), ".wad"))
-				{
-					fsize = FSOPGetFileSizeBytes(tmpPath);
-					addFlag = true;
-					iswad = true;
-				}
-				if (!strcasecmp(strrchr(ent->d_name, '.'), ".dol"))
-				{
-					fsize = FSOPGetFileSizeBytes(tmpPath);
-					addFlag = true;
-					isdol = true;
-				}
-				if (!strcasecmp(strrchr(ent->d_name, '.'), ".elf"))
+				if (i > 0 && __Menu_EntryCmp(&merged[i - 1], &batch[j - 1]) > 0)
+					merged[--k] = merged[--i];
+				else
 				{
-					fsize = FSOPGetFileSizeBytes(tmpPath);
-					addFlag = true;
-					iself = true;
+					if ((s32)i <= *selected)
+						before++;
+
+					merged[--k] = batch[--j];
 				}
 			}
-		}
 
-		if (addFlag)
-		{
-			buffer = reallocarray(*outbuf, cnt + 1, sizeof(fatFile));
-			if (!buffer) // Reallocation failed. Why?
+			if (*cnt && *selected > 0)
 			{
-				free(*outbuf);
-				*outbuf = NULL;
-				return -997;
+				*selected += before;
+				*start += before;
 			}
-			*outbuf = buffer;
-
-			fatFile *file = &buffer[cnt++];
-
-			// Clear fatFile structure
-			memset(file, 0, sizeof(fatFile));
 
-			/* File name */
-			strcpy(file->filename, ent->d_name);
-
-			/* File stats */
-			file->isdir = isdir;
-			file->fsize = fsize;
-			file->isdol = isdol;
-			file->iself = iself;
-			file->iswad = iswad;
+			*list = merged;
+			*cnt += n;
 		}
 	}
 
-	/* Sort list */
-	qsort(buffer, cnt, sizeof(fatFile), __Menu_EntryCmp);
+	free(batch);
 
-	/* Close directory */
-	closedir(dir);
+	if (done)
+		__Menu_StopList();
 
-	/* Set values */
-	*outbuf = buffer;
-	*outlen = cnt;
+	return done;
+}
 
-	return 0;
+/* Fills in the size of a listed file, only stats it the first time */
+static size_t __Menu_GetEntrySize(fatFile *file, const char *inPath)
+{
+	char tmpPath[MAX_FILE_PATH_LEN];
+
+	if (!file->isdir && !file->sized)
+	{
+		snprintf(tmpPath, MAX_FILE_PATH_LEN, "%s/%s", inPath, file->filename);
+		file->fsize = FSOPGetFileSizeBytes(tmpPath);
+		file->sized = true;
+	}
+
+	return file->fsize;
 }
 
 void Menu_SelectIOS(void)
@@ -531,12 +754,78 @@ err:
 	Menu_NandDevice();
 }
 
+/* Per-WAD results of a batch, scrollable */
+static void __Menu_ShowResults(fatFile **log, int count)
+{
+	int success = 0, skipped = 0, errors = 0;
+	int start = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (log[i]->installstate >= 0) success++; else
+		if (log[i]->installstate == -998) skipped++; else
+		errors++;
+	}
+
+	while (true)
+	{
+		Con_Clear();
+
+		printf("[+] End results: %d succeeded", success);
+		if (skipped)
+			printf(", %d already installed", skipped);
+		printf(", %d failed\n\n", errors);
+
+		for (int i = 0; i < ENTRIES_PER_PAGE; i++)
+		{
+			int index = start + i;
+			if (index >= count) // Data store interrupt safety!!
+				putchar('\n');
+			else
+				printf("    %-.32s: %s\n", log[index]->filename, wad_strerror(log[index]->installstate));
+		}
+
+		putchar('\n');
+		printf("[+] Press UP/DOWN to move list, LEFT/RIGHT to move a page.\n");
+		printf("    Press A to continue.");
+
+		u32 buttons = WaitButtons();
+
+		if (buttons & WPAD_BUTTON_UP)
+		{
+			if (start) start--;
+		}
+		else if (buttons & WPAD_BUTTON_DOWN)
+		{
+			if (count - start > ENTRIES_PER_PAGE) start++;
+		}
+		else if (buttons & WPAD_BUTTON_LEFT)
+		{
+			start = (start > ENTRIES_PER_PAGE) ? start - ENTRIES_PER_PAGE : 0;
+		}
+		else if (buttons & WPAD_BUTTON_RIGHT)
+		{
+			if (count - start > ENTRIES_PER_PAGE)
+				start += ENTRIES_PER_PAGE;
+
+			if (count - start < ENTRIES_PER_PAGE)
+				start = (count > ENTRIES_PER_PAGE) ? count - ENTRIES_PER_PAGE : 0;
+		}
+		else if (buttons & WPAD_BUTTON_A)
+		{
+			break;
+		}
+	}
+}
+
 char gTmpFilePath[MAX_FILE_PATH_LEN];
 /* Install and/or Uninstall multiple WADs - Leathl */
 int Menu_BatchProcessWads(fatFile *files, int fileCount, char *inFilePath)
 {
 	int installCnt = 0;
 	int uninstallCnt = 0;
+	int skipCnt = 0;
+	int failCnt = 0;
 	int count;
 
 	for (fatFile* f = files; f < files + fileCount; f++) {
@@ -547,24 +836,62 @@ int Menu_BatchProcessWads(fatFile *files, int fileCount, char *inFilePath)
 	if (!(installCnt || uninstallCnt))
 		return 0;
 
-	for (;;)
+	/* Plan the batch, every WAD is read once through the folder index */
+	WadPlanStep *plan = calloc(installCnt + uninstallCnt, sizeof(WadPlanStep));
+	if (!plan)
+		return 0;
+
+	Con_Clear();
+	printf("[+] Reading %d WAD%s, please wait...\n", installCnt + uninstallCnt, (installCnt + uninstallCnt == 1) ? "" : "s");
+
+	WadIndex_Open(inFilePath);
+
+	u32 steps = 0;
+	for (count = 0; count < fileCount; count++)
+	{
+		fatFile *thisFile = &files[count];
+
+		if (!thisFile->install)
+			continue;
+
+		WadPlanStep *step = &plan[steps++];
+		step->item = count;
+		step->mode = thisFile->install;
+		step->ret  = WadIndex_Get(thisFile->filename, &step->info);
+	}
+
+	WadPlan_Build(plan, steps);
+
+	for (u32 i = 0; i < steps; i++)
+	{
+		if (plan[i].action == WADPLAN_SKIP) skipCnt++; else
+		if (plan[i].action == WADPLAN_FAIL) failCnt++;
+	}
+
+	/* Unattended batches start right away */
+	while (!gConfig.unattended)
 	{
 		Con_Clear();
 
 		if ((installCnt > 0) & (uninstallCnt == 0)) {
 			printf("[+] %d file%s marked for installation.\n", installCnt, (installCnt == 1) ? "" : "s");
-			printf("    Do you want to proceed?\n");
 		}
 		else if ((installCnt == 0) & (uninstallCnt > 0)) {
 			printf("[+] %d file%s marked for uninstallation.\n", uninstallCnt, (uninstallCnt == 1) ? "" : "s");
-			printf("    Do you want to proceed?\n");
 		}
 		else {
 			printf("[+] %d file%s marked for installation.\n", installCnt, (installCnt == 1) ? "" : "s");
 			printf("[+] %d file%s marked for uninstallation.\n", uninstallCnt, (uninstallCnt == 1) ? "" : "s");
-			printf("    Do you want to proceed?\n");
 		}
 
+		if (skipCnt)
+			printf("    %d already installed, will be skipped.\n", skipCnt);
+
+		if (failCnt)
+			printf("    %d can't be processed, see the list afterwards.\n", failCnt);
+
+		printf("    Do you want to proceed?\n");
+
 		printf("\n\n    Press A to continue.\n");
 		printf("    Press B to go back to the menu.\n\n");
 
@@ -574,110 +901,124 @@ int Menu_BatchProcessWads(fatFile *files, int fileCount, char *inFilePath)
 			break;
 
 		if (buttons & WPAD_BUTTON_B)
+		{
+			free(plan);
 			return 0;
+		}
 	}
 
 	WiiLightControl (WII_LIGHT_ON);
 	int errors = 0;
 	int success = 0;
+	int skipped = 0;
 	s32 ret;
 
-	for (count = 0; count < fileCount; count++)
+	/* Results in the order they happened */
+	fatFile *log[steps];
+
+	/* Kept next to the WADs so an interrupted batch can be resumed */
+	WadJournal_Begin(inFilePath, steps);
+	for (u32 i = 0; i < steps; i++)
+		WadJournal_Add(files[plan[i].item].filename, plan[i].mode, (plan[i].ret >= 0) ? &plan[i].info : NULL, plan[i].action == WADPLAN_SKIP);
+
+	Wad_SetProgress(WadJournal_Progress);
+
+	for (u32 i = 0; i < steps; i++)
 	{
-		fatFile *thisFile = &files[count];
+		WadPlanStep *step = &plan[i];
+		fatFile *thisFile = &files[step->item];
+
+		log[i] = thisFile;
 
-		int mode = thisFile->install;
-		if (mode) 
+		if (step->action == WADPLAN_SKIP)
 		{
-			Con_Clear();
-			printf("[+] Processing WAD: %d/%d...\n\n", (errors + success + 1), (installCnt + uninstallCnt));
-			printf("[+] Opening \"%s\", please wait...\n\n", thisFile->filename);
+			thisFile->installstate = -998;
+			skipped++;
+			continue;
+		}
+
+		/* Unreadable or missing its IOS, nothing to wait for */
+		if (step->action == WADPLAN_FAIL)
+		{
+			thisFile->installstate = step->ret;
+			WadJournal_SetState(i, WADJOURNAL_FAILED, step->ret);
+			errors++;
+			continue;
+		}
 
-			sprintf(gTmpFilePath, "%s/%s", inFilePath, thisFile->filename);
+		WadJournal_SetState(i, WADJOURNAL_RUNNING, 0);
 
+		int mode = step->mode;
+
+		Con_Clear();
+		printf("[+] Processing WAD: %d/%d", (errors + success + skipped + 1), (installCnt + uninstallCnt));
+		if (errors)
+			printf(" (%d failed)", errors);
+		printf("...\n\n");
+		printf("[+] Opening \"%s\", please wait...\n\n", thisFile->filename);
+
+		sprintf(gTmpFilePath, "%s/%s", inFilePath, thisFile->filename);
+
+		if (mode == 2) 
+		{
 			FILE *fp = fopen(gTmpFilePath, "rb");
 			if (!fp) 
 			{
 				printf(" ERROR!\n");
+				thisFile->installstate = -996;
+				WadJournal_SetState(i, WADJOURNAL_FAILED, -996);
 				errors += 1;
 				continue;
 			}
-			
-			if (mode == 2) 
-			{
-				printf(">> Uninstalling WAD, please wait...\n\n");
-				ret = Wad_Uninstall(fp);
-			}
-			else 
-			{
-				printf(">> Installing WAD, please wait...\n\n");
-				ret = Wad_Install(fp);
-			}
 
-			if (ret < 0) 
+			printf(">> Uninstalling WAD, please wait...\n\n");
+			ret = Wad_Uninstall(fp);
+			fclose(fp);
+		}
+		else 
+		{
+			/* The next install is read while this one goes to the NAND */
+			char nextPath[MAX_FILE_PATH_LEN];
+			char *next = NULL;
+
+			for (u32 j = i + 1; j < steps && !next; j++)
 			{
-				if ((errors + success + 1) < (installCnt + uninstallCnt))
+				if (plan[j].action == WADPLAN_RUN && plan[j].mode == 1)
 				{
-					s32 i;
-					for (i = 5; i > 0; i--)
-					{
-						printf("\r   Continue in: %d", i);
-						sleep(1);
-					}
+					sprintf(nextPath, "%s/%s", inFilePath, files[plan[j].item].filename);
+					next = nextPath;
 				}
-
-				errors++;
 			}
-			else 
-			{
-				success++;
-			}
-
-			thisFile->installstate = ret;
 
-			if (fp)
-				fclose(fp);
+			printf(">> Installing WAD, please wait...\n\n");
+			ret = Wad_InstallFile(gTmpFilePath, next);
 		}
-	}
-
-	WiiLightControl(WII_LIGHT_OFF);
 
-	printf("\n");
-	printf("    %d titles succeeded and %d failed...\n", success, errors);
+		if (ret < 0) 
+		{
+			/* Titles waiting on this IOS won't get it */
+			WadPlan_Failed(plan, steps, i);
+			errors++;
+		}
+		else 
+		{
+			success++;
+		}
 
-	if (errors > 0)
-	{
-		printf("\n    Some operations failed");
-		printf("\n    Press A to list.\n");
-		printf("    Press B skip.\n");
+		thisFile->installstate = ret;
+		WadJournal_SetState(i, (ret < 0) ? WADJOURNAL_FAILED : WADJOURNAL_DONE, ret);
+	}
 
-		u32 buttons = WaitButtons();
+	Wad_SetProgress(NULL);
+	WadJournal_End();
 
-		if ((buttons & WPAD_BUTTON_A))
-		{
-			Con_Clear();
+	Wad_DropPrefetch();
+	free(plan);
 
-			int i = 0;
-			for (count = 0; count < fileCount; count++)
-			{
-				fatFile *thisFile = &files[count];
+	WiiLightControl(WII_LIGHT_OFF);
 
-				if (thisFile->installstate < 0)
-				{
-					printf("    %.40s: %s\n", thisFile->filename, wad_strerror(thisFile->installstate));
-					i++;
-
-					
-					if (i == 17)
-					{
-						printf("\n    Press any button to continue\n");
-						WaitButtons();
-						i = 0;
-					}
-				}
-			}
-		}
-	}
+	/* Errors stay on screen here instead of stalling the batch */
+	__Menu_ShowResults(log, steps);
 
 	if (gNeedPriiloaderOption)
 	{
@@ -685,13 +1026,46 @@ int Menu_BatchProcessWads(fatFile *files, int fileCount, char *inFilePath)
 
 		gNeedPriiloaderOption = false;
 	}
-	else
+
+	return 1;
+}
+
+/* Offers to finish a batch that was interrupted, from its journal */
+static void __Menu_ResumeBatch(char *folder)
+{
+	fatFile *files;
+	u32 done, total;
+
+	s32 left = WadJournal_Load(folder, &files, &done, &total);
+	if (left <= 0)
+		return;
+
+	while (!gConfig.unattended)
 	{
-		printf("\n    Press any button to continue...\n");
-		WaitButtons();
+		Con_Clear();
+
+		printf("[+] A batch in this folder was interrupted.\n");
+		printf("    %u of %u WADs were done, %d left.\n", done, total, left);
+		printf("    Do you want to resume it?\n");
+
+		printf("\n\n    Press A to resume.\n");
+		printf("    Press B to forget about it.\n\n");
+
+		u32 buttons = WaitButtons();
+
+		if (buttons & WPAD_BUTTON_A)
+			break;
+
+		if (buttons & WPAD_BUTTON_B)
+		{
+			WadJournal_Discard(folder);
+			free(files);
+			return;
+		}
 	}
 
-	return 1;
+	Menu_BatchProcessWads(files, left, folder);
+	free(files);
 }
 
 /* File Operations - Leathl */
@@ -763,13 +1137,16 @@ int Menu_FolderOperations(fatFile* file, char* path)
 
 	char workpath[MAX_FILE_PATH_LEN];
 
+	/* Not the WAD list's arena, it has the browsed folder. Without memory of
+	 * its own this one hands out heap blocks. */
+	Arena        farena = {};
 	fatFile     *flist = NULL;
 	unsigned int fcnt = 0;
 	unsigned int wadcnt = 0;
 
 	char* ptr_fname = workpath + sprintf(workpath, "%s%s/", path, file->filename);
 
-	ret = __Menu_RetrieveList(workpath, &flist, &fcnt);
+	ret = __Menu_RetrieveList(workpath, &farena, &flist, &fcnt);
 	if (ret != 0)
 	{
 		WaitPrompt("__Menu_RetrieveList failed");
@@ -816,7 +1193,7 @@ int Menu_FolderOperations(fatFile* file, char* path)
 	}
 
 	int start = 0; // No cursor here so we just need start
-	while (true)
+	while (!gConfig.unattended)
 	{
 		Con_Clear();
 
@@ -855,91 +1232,68 @@ int Menu_FolderOperations(fatFile* file, char* path)
 		}
 	}
 
+	int failed = 0;
 	for (int i = 0; i < wadcnt; i++)
 	{
 		fatFile *f  = wads[i];
-		FILE    *fp = NULL;
+
+		/* The next WAD is read while this one goes to the NAND */
+		char  nextPath[MAX_FILE_PATH_LEN];
+		char *next = NULL;
 
 		Con_Clear();
 
-		printf("[+] Processing WAD %i/%i...\n\n", i + 1, wadcnt);
+		printf("[+] Processing WAD %i/%i", i + 1, wadcnt);
+		if (failed)
+			printf(" (%i failed)", failed);
+		printf("...\n\n");
 
 		printf("[+] Opening \"%s\", please wait...\n", f->filename);
 		strcpy(ptr_fname, f->filename);
-		fp = fopen(workpath, "rb");
-		if (!fp)
-		{
-			printf("    ERROR! (errno=%i)\n", errno);
-		}
-		else
-		{
-			// puts(">> Installing WAD...");
-			f->installstate = ret = Wad_Install(fp);
-			fclose(fp);
 
-			if (!ret)
-			{
-				if (mode == 1)
-				{
-					printf(">> Deleting WAD... ");
-					// ret = FSOPDeleteFile(workpath);
-					ret = remove(workpath);
-					if (!ret)
-						puts("OK!");
-					else
-						printf("ERROR! (errno=%i)\n", errno);
-				}
-			}
-			else if (ret == -1010)
-			{
-				do { wads[i++]->installstate = -1010; } while (i < wadcnt);
-				WaitPrompt("Wii System Memory is full to the brim. Installation terminated...\n");
-				break;
-			}
-		}
-
-		usleep((!ret) ? 500000 : 4000000);
-		continue;
-	}
-
-	start = 0;
-	while (true)
-	{
-		Con_Clear();
-
-		printf("[+] End results:\n\n");
-
-		for (int i = 0; i < ENTRIES_PER_PAGE; i++)
+		if (i + 1 < wadcnt)
 		{
-			int index = start + i;
-			if (index >= wadcnt) // Data store interrupt safety!!
-				putchar('\n');
-			else
-				printf("    %-.32s: %s\n", wads[index]->filename, wad_strerror(wads[index]->installstate));
+			sprintf(nextPath, "%s%s/%s", path, file->filename, wads[i + 1]->filename);
+			next = nextPath;
 		}
 
-		putchar('\n');
-		printf("[+] Press UP/DOWN to move list.\n");
-		printf("    Press A to continue.");
-
-		u32 buttons = WaitButtons();
+		// puts(">> Installing WAD...");
+		f->installstate = ret = Wad_InstallFile(workpath, next);
 
-		if (buttons & WPAD_BUTTON_UP)
+		if (!ret)
 		{
-			if (start) start--;
+			if (mode == 1)
+			{
+				printf(">> Deleting WAD... ");
+				// ret = FSOPDeleteFile(workpath);
+				ret = remove(workpath);
+				if (!ret)
+					puts("OK!");
+				else
+					printf("ERROR! (errno=%i)\n", errno);
+			}
 		}
-		else if (buttons & WPAD_BUTTON_DOWN)
+		else if (ret == -1010)
 		{
-			if (wadcnt - start > ENTRIES_PER_PAGE) start++;
+			do { wads[i++]->installstate = -1010; } while (i < wadcnt);
+
+			if (!gConfig.unattended)
+				WaitPrompt("Wii System Memory is full to the brim. Installation terminated...\n");
+			break;
 		}
-		else if (buttons & WPAD_BUTTON_A)
+		else
 		{
-			break;
+			failed++;
 		}
 	}
 
+	Wad_DropPrefetch();
+
+	/* Errors stay on screen here instead of stalling the folder */
+	__Menu_ShowResults(wads, wadcnt);
+
 finish:
-	free(flist);
+	Arena_Free(&farena, flist);
 	return 0;
 }
 
@@ -955,12 +1309,27 @@ void Menu_WadManage(fatFile *file, char *inFilePath)
 	/* File size in megabytes */
 	filesize = (file->fsize / MB_SIZE);
 
+	/* What's inside, from the folder index if it's up to date */
+	WadInfo info;
+	bool haveInfo = file->iswad && WadIndex_Get(file->filename, &info) >= 0;
+
 	for (;;) {
 		/* Clear console */
 		Con_Clear();
 		if(file->iswad) {
 			printf("[+] WAD Filename : %s\n", file->filename);
-			printf("    WAD Filesize : %.2f MB\n\n", filesize);
+			printf("    WAD Filesize : %.2f MB\n", filesize);
+
+			if (haveInfo)
+			{
+				printf("    Title ID     : %08X-%08X v%u\n", (u32)(info.titleID >> 32), (u32)info.titleID, info.version);
+
+				if ((info.sysVersion >> 32) == 1)
+					printf("    Title IOS    : IOS%u\n", (u32)info.sysVersion);
+				else if (info.flags & WADINFO_STUB_IOS)
+					printf("    IOS          : stub\n");
+			}
+			putchar('\n');
 
 
 			printf("[+] Select action: < %s WAD >\n\n", (!mode) ? "Install" : "Uninstall");
@@ -1075,9 +1444,10 @@ out:
 void Menu_WadList(void)
 {
 	fatFile *fileList = NULL;
-	u32      fileCnt;
+	u32      fileCnt = 0;
 	int ret, selected = 0, start = 0;
 	bool batchMode = false;
+	bool listed = false;
 	char tmpPath[MAX_FILE_PATH_LEN];
 
 	Con_Clear();
@@ -1102,16 +1472,25 @@ void Menu_WadList(void)
 
 	/* Retrieve filelist */
 getList:
-    free(fileList);
-    fileList = NULL;
+	__Menu_StopList();
+	__Menu_FreeList(&fileList);
+	fileCnt = 0;
 
-	ret = __Menu_RetrieveList(tmpPath, &fileList, &fileCnt);
+	ret = __Menu_StartList(tmpPath);
 	if (ret < 0) 
 	{
 		printf(" ERROR! (ret = %d)\n", ret);
 		goto err;
 	}
 
+	/* Show the first page as soon as there is one */
+	listed = __Menu_MergeList(&fileList, &fileCnt, &selected, &start);
+	while (!listed && fileCnt < ENTRIES_PER_PAGE)
+	{
+		VIDEO_WaitVSync();
+		listed = __Menu_MergeList(&fileList, &fileCnt, &selected, &start);
+	}
+
 	/* No files */
 	if (!fileCnt) 
 	{
@@ -1119,6 +1498,14 @@ getList:
 		goto err;
 	}
 
+	/* WAD details from the last visit, forget the ones that are gone */
+	WadIndex_Open(tmpPath);
+	if (listed)
+		WadIndex_Prune(fileList, fileCnt);
+
+	/* A batch that never got to its end results */
+	__Menu_ResumeBatch(tmpPath);
+
 	/* Set install-values to 0 - Leathl */
 /*
 	int counter;
@@ -1134,6 +1521,14 @@ getList:
 		u32 cnt;
 		s32 index;
 
+		/* Pick up what the lister found in the meantime */
+		if (!listed)
+		{
+			listed = __Menu_MergeList(&fileList, &fileCnt, &selected, &start);
+			if (listed)
+				WadIndex_Prune(fileList, fileCnt);
+		}
+
 		/* Clear console */
 		Con_Clear();
 
@@ -1143,18 +1538,21 @@ getList:
 		if ((pathEnd - pathStart) > 30)
 			pathStart = pathEnd - 30;
 		
-		printf("[+] Files on [%s]:\n\n", pathStart);
+		if (listed)
+			printf("[+] Files on [%s]:\n\n", pathStart);
+		else
+			printf("[+] Files on [%s]: (%u so far...)\n\n", pathStart, fileCnt);
 		
 		/* Print entries */
 		for (cnt = start; cnt < fileCnt; cnt++)
 		{
-			fatFile *file     = &fileList[cnt];
-			f32      filesize = file->fsize / MB_SIZE;
-
 			/* Entries per page limit */
 			if ((cnt - start) >= ENTRIES_PER_PAGE)
 				break;
 
+			fatFile *file     = &fileList[cnt];
+			f32      filesize = __Menu_GetEntrySize(file, tmpPath) / MB_SIZE;
+
 
 			/* Print filename */
 			//printf("\t%2s %s (%.2f MB)\n", (cnt == selected) ? ">>" : "  ", file->filename, filesize);
@@ -1203,7 +1601,11 @@ getList:
 
 
 		/** Controls **/
-		u32 buttons = WaitButtons();
+		u32 buttons = listed ? WaitButtons() : WaitButtonsTimeout(LIST_REFRESH_FRAMES);
+
+		/* Nothing pressed, redraw with the new entries */
+		if (!buttons)
+			continue;
 			
 		/* DPAD buttons */
 		if (buttons & WPAD_BUTTON_UP) 
@@ -1343,7 +1745,12 @@ getList:
 		else if (buttons & WPAD_BUTTON_B)
 		{
 			if (atRoot)
+			{
+				__Menu_StopList();
+				__Menu_FreeList(&fileList);
+				WadIndex_Close();
 				return;
+			}
 
 			selected = start = 0;
 			
@@ -1365,6 +1772,10 @@ getList:
 	}
 
 err:
+	__Menu_StopList();
+	__Menu_FreeList(&fileList);
+	WadIndex_Close();
+
 	printf("\n");
 	printf("    Press any button to continue...\n");
 
@@ -1506,6 +1917,13 @@ u32 WiiDRC_GetButtons(void)
 // is mapped to the "SELECT" button on the Gamecube Ctrl. (wiiNinja 5/15/2009)
 u32 WaitButtons(void)
 {
+	return WaitButtonsTimeout(0);
+}
+
+/* Gives up after a number of frames and returns 0, 0 waits forever */
+u32 WaitButtonsTimeout(u32 frames)
+{
+	bool forever = !frames;
 	u32 buttons = 0;
     u32 buttonsGC = 0;
 	u32 buttonsDRC = 0;
@@ -1514,6 +1932,9 @@ u32 WaitButtons(void)
 	/* Wait for button pressing */
 	while (!(buttons | buttonsGC | buttonsDRC | buttonsWKB))
     {
+		if (!forever && !frames--)
+			return 0;
+
 		// Wii buttons
 		buttons = Wpad_GetButtons();
 
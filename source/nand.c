@@ -4,6 +4,8 @@
 #include <string.h>
 
 #include "nand.h"
+#include "title.h"
+#include "wad.h"
 #include "malloc.h"
 #include "fileops.h"
 
@@ -63,6 +65,10 @@ s32 Nand_Enable(nandDevice *dev)
 	/* Enable NAND emulator */
 	ret = IOS_Ioctl(fd, 100, inbuf, sizeof(inbuf), NULL, 0);
 
+	/* Different NAND, different titles */
+	Title_FlushCaches();
+	Wad_FlushPolicy();
+
 	/* Close /dev/fs */
 	IOS_Close(fd);
 
@@ -84,6 +90,10 @@ s32 Nand_Disable(void)
 	/* Disable NAND emulator */
 	ret = IOS_Ioctl(fd, 100, inbuf, sizeof(inbuf), NULL, 0);
 
+	/* Different NAND, different titles */
+	Title_FlushCaches();
+	Wad_FlushPolicy();
+
 	/* Close /dev/fs */
 	IOS_Close(fd);
 
@@ -101,7 +111,15 @@ bool NANDInitialize()
 	return gNandInitialized;
 }
 
-u8* NANDReadFromFile(const char* path, u32 offset, u32 length, u32* size)
+static void __NANDFree(Arena* arena, void* data)
+{
+	if (arena)
+		Arena_Free(arena, data);
+	else
+		free(data);
+}
+
+static u8* __NANDReadFromFile(Arena* arena, const char* path, u32 offset, u32 length, u32* size)
 {
 	*size = ISFS_EINVAL;
 
@@ -118,7 +136,7 @@ u8* NANDReadFromFile(const char* path, u32 offset, u32 length, u32* size)
 		if (!length)
 			length = IOS_Seek(fd, 0, SEEK_END);
 
-		u8* data = memalign64(length);
+		u8* data = arena ? Arena_Alloc(arena, length, 64) : memalign64(length);
 		if (!data)
 		{
 			*size = 0;
@@ -130,7 +148,7 @@ u8* NANDReadFromFile(const char* path, u32 offset, u32 length, u32* size)
 		if (*size < 0)
 		{
 			IOS_Close(fd);
-			free(data);
+			__NANDFree(arena, data);
 			return NULL;
 		}
 
@@ -138,7 +156,7 @@ u8* NANDReadFromFile(const char* path, u32 offset, u32 length, u32* size)
 		IOS_Close(fd);
 		if (*size != length)
 		{
-			free(data);
+			__NANDFree(arena, data);
 			return NULL;
 		}
 
@@ -148,9 +166,20 @@ u8* NANDReadFromFile(const char* path, u32 offset, u32 length, u32* size)
 	return NULL;
 }
 
+u8* NANDReadFromFile(const char* path, u32 offset, u32 length, u32* size)
+{
+	return __NANDReadFromFile(NULL, path, offset, length, size);
+}
+
 u8* NANDLoadFile(const char* path, u32* size)
 {
-	return NANDReadFromFile(path, 0, 0, size);
+	return __NANDReadFromFile(NULL, path, 0, 0, size);
+}
+
+/* Same, but into the arena, free with Arena_Free */
+u8* NANDLoadFileArena(Arena* arena, const char* path, u32* size)
+{
+	return __NANDReadFromFile(arena, path, 0, 0, size);
 }
 
 s32 NANDWriteFileSafe(const char* path, u8* data, u32 size)
@@ -215,6 +244,89 @@ s32 NANDBackUpFile(const char* src, const char* dst, u32* size)
 	return ret;
 }
 
+/* Both files a chunk at a time, the first difference ends it. Returns 0
+ * when they match, 1 when they don't. */
+#define NAND_COMPARE_CHUNK	0x8000
+
+s32 NANDCompareFiles(const char* pathA, const char* pathB)
+{
+	u8* buffer = NULL;
+	s32 fdB = -1;
+	s32 ret, size;
+
+	NANDInitialize();
+
+	s32 fdA = IOS_Open(pathA, 1);
+	if (fdA < 0)
+		return fdA;
+
+	fdB = IOS_Open(pathB, 1);
+	if (fdB < 0)
+	{
+		ret = fdB;
+		goto out;
+	}
+
+	size = IOS_Seek(fdA, 0, SEEK_END);
+	ret  = IOS_Seek(fdB, 0, SEEK_END);
+	if (size < 0 || ret < 0)
+	{
+		ret = (size < 0) ? size : ret;
+		goto out;
+	}
+
+	/* Different sizes can't match, nothing to read */
+	if (ret != size)
+	{
+		ret = 1;
+		goto out;
+	}
+
+	if ((ret = IOS_Seek(fdA, 0, SEEK_SET)) < 0 || (ret = IOS_Seek(fdB, 0, SEEK_SET)) < 0)
+		goto out;
+
+	buffer = memalign32(NAND_COMPARE_CHUNK * 2);
+	if (!buffer)
+	{
+		ret = -1;
+		goto out;
+	}
+
+	for (s32 done = 0; done < size; done += NAND_COMPARE_CHUNK)
+	{
+		s32 len = (size - done < NAND_COMPARE_CHUNK) ? size - done : NAND_COMPARE_CHUNK;
+
+		ret = IOS_Read(fdA, buffer, len);
+		if (ret == len)
+			ret = IOS_Read(fdB, buffer + NAND_COMPARE_CHUNK, len);
+
+		if (ret != len)
+		{
+			if (ret >= 0)
+				ret = -996;
+
+			goto out;
+		}
+
+		if (memcmp(buffer, buffer + NAND_COMPARE_CHUNK, len))
+		{
+			ret = 1;
+			goto out;
+		}
+	}
+
+	ret = 0;
+
+out:
+	free(buffer);
+
+	if (fdB >= 0)
+		IOS_Close(fdB);
+
+	IOS_Close(fdA);
+	return ret;
+}
+
 s32 NANDGetFileSize(const char* path, u32* size)
 {
 	NANDInitialize();
@@ -1,6 +1,8 @@
 #ifndef _NAND_H_
 #define _NAND_H_
 
+#include "arena.h"
+
 /* 'NAND Device' structure */
 typedef struct {
 	/* Device name */
@@ -29,8 +31,10 @@ s32 Nand_Disable(void);
 bool NANDInitialize();
 u8* NANDReadFromFile(const char* path, u32 offset, u32 length, u32* size);
 u8* NANDLoadFile(const char* path, u32* size);
+u8* NANDLoadFileArena(Arena* arena, const char* path, u32* size);
 s32 NANDWriteFileSafe(const char* path, u8* data, u32 size);
 s32 NANDBackUpFile(const char* src, const char* dst, u32* size);
+s32 NANDCompareFiles(const char* pathA, const char* pathB);
 s32 NANDGetFileSize(const char* path, u32* size);
 s32 NANDDeleteFile(const char* path);
 
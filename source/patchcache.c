@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+#include <gctypes.h>
+
+#include "patchcache.h"
+
+/* Constants */
+#define PATCHCACHE_MAGIC	0x574D5043	// "WMPC"
+#define PATCHCACHE_VERSION	1
+#define PATCHCACHE_ENTRIES	8
+
+typedef struct
+{
+	u32 magic;
+	u32 version;
+	u32 count;
+	u32 entrySize;
+} ATTRIBUTE_PACKED PatchCacheHeader;
+
+/* Newest first */
+typedef struct
+{
+	PatchCacheHeader header;
+	PatchCacheEntry entries[PATCHCACHE_ENTRIES];
+} PatchCacheFile;
+
+/* No path, no cache */
+static char gPath[128];
+
+void PatchCache_SetPath(const char* path)
+{
+	snprintf(gPath, sizeof(gPath), "%s", path ? path : "");
+}
+
+/* Entries read, a missing or foreign file is an empty cache */
+static u32 __PatchCache_Read(PatchCacheFile* file)
+{
+	u32 count = 0;
+
+	FILE* fp = fopen(gPath, "rb");
+	if (!fp)
+		return 0;
+
+	if (fread(&file->header, sizeof(PatchCacheHeader), 1, fp) == 1
+	&&  file->header.magic == PATCHCACHE_MAGIC
+	&&  file->header.version == PATCHCACHE_VERSION
+	&&  file->header.entrySize == sizeof(PatchCacheEntry)
+	&&  file->header.count <= PATCHCACHE_ENTRIES)
+		count = fread(file->entries, sizeof(PatchCacheEntry), file->header.count, fp);
+
+	fclose(fp);
+	return count;
+}
+
+static bool __PatchCache_Match(const PatchCacheEntry* entry, u16 ios, u16 revision, u32 sets, u32 size)
+{
+	return entry->ios == ios && entry->revision == revision && entry->sets == sets && entry->size == size;
+}
+
+bool PatchCache_Find(u16 ios, u16 revision, u32 sets, u32 size, PatchCacheEntry* out)
+{
+	PatchCacheFile file;
+
+	if (!gPath[0])
+		return false;
+
+	u32 count = __PatchCache_Read(&file);
+
+	for (u32 i = 0; i < count; i++)
+	{
+		const PatchCacheEntry* entry = &file.entries[i];
+
+		if (__PatchCache_Match(entry, ios, revision, sets, size) && entry->count <= PATCHCACHE_MAX_HITS)
+		{
+			*out = *entry;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Replaces the entry of the same IOS revision, or the oldest one */
+void PatchCache_Store(const PatchCacheEntry* entry)
+{
+	PatchCacheFile file;
+
+	if (!gPath[0])
+		return;
+
+	u32 count = __PatchCache_Read(&file), kept = 1;
+	PatchCacheEntry entries[PATCHCACHE_ENTRIES];
+
+	entries[0] = *entry;
+
+	for (u32 i = 0; i < count && kept < PATCHCACHE_ENTRIES; i++)
+	{
+		const PatchCacheEntry* old = &file.entries[i];
+
+		if (!__PatchCache_Match(old, entry->ios, entry->revision, entry->sets, entry->size))
+			entries[kept++] = *old;
+	}
+
+	PatchCacheHeader header = { PATCHCACHE_MAGIC, PATCHCACHE_VERSION, kept, sizeof(PatchCacheEntry) };
+
+	/* A cache that can't be written only costs a scan next time */
+	FILE* fp = fopen(gPath, "wb");
+	if (!fp)
+		return;
+
+	fwrite(&header, sizeof(header), 1, fp);
+	fwrite(entries, sizeof(PatchCacheEntry), kept, fp);
+	fclose(fp);
+}
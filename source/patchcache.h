@@ -0,0 +1,28 @@
+#ifndef _PATCHCACHE_H_
+#define _PATCHCACHE_H_
+
+#include <gctypes.h>
+
+/* Constants */
+#define PATCHCACHE_MAX_HITS		32
+
+/* Where the patches of one IOS revision were found, offsets are from the
+ * start of the scanned memory */
+typedef struct
+{
+	u16 ios;
+	u16 revision;
+	u32 sets;
+	u32 size;
+
+	u32 count;
+	u8  patch[PATCHCACHE_MAX_HITS];
+	u32 offset[PATCHCACHE_MAX_HITS];
+} ATTRIBUTE_PACKED PatchCacheEntry;
+
+/* Prototypes */
+void PatchCache_SetPath(const char* path);
+bool PatchCache_Find(u16 ios, u16 revision, u32 sets, u32 size, PatchCacheEntry* out);
+void PatchCache_Store(const PatchCacheEntry* entry);
+
+#endif
@@ -0,0 +1,131 @@
+#include <stdint.h>
+#include <string.h>
+#include <gctypes.h>
+
+#include "patchscan.h"
+
+/* The first word of every signature goes into a bitmap, which turns
+ * almost every position away after one lookup */
+#define FILTER_BITS	12
+
+typedef struct
+{
+	u32 filter[(1 << FILTER_BITS) / 32];
+
+	/* First word and patch of each signature in the scan */
+	u32 keys[PATCHSCAN_MAX_PATTERNS];
+	u8  index[PATCHSCAN_MAX_PATTERNS];
+	u32 count;
+} PatchScanTable;
+
+/* Big-endian word from any address; a single load on the Wii */
+static inline u32 load32(const u8* p)
+{
+	u32 v;
+	__builtin_memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	v = __builtin_bswap32(v);
+#endif
+	return v;
+}
+
+static inline u32 __PatchScan_Hash(u32 key)
+{
+	return (key * 0x9E3779B1) >> (32 - FILTER_BITS);
+}
+
+static void __PatchScan_Match(const PatchScanTable* table, const u8* mem, u32 size, u32 pos, u32 window, const IOSPatch* patches, PatchScanHits* hits)
+{
+	for (u32 i = 0; i < table->count; i++)
+	{
+		if (table->keys[i] != window)
+			continue;
+
+		const IOSPatch* patch = &patches[table->index[i]];
+
+		if (patch->oldSize > size - pos || memcmp(mem + pos + 4, patch->old + 4, patch->oldSize - 4))
+			continue;
+
+		PatchScanHits* hit = &hits[table->index[i]];
+
+		if (hit->hits < PATCHSCAN_MAX_OFFSETS)
+			hit->offsets[hit->hits] = pos;
+
+		hit->hits++;
+	}
+}
+
+static inline void __PatchScan_Check(const PatchScanTable* table, const u8* mem, u32 size, u32 pos, u32 window, const IOSPatch* patches, PatchScanHits* hits)
+{
+	u32 bit = __PatchScan_Hash(window);
+
+	if (table->filter[bit >> 5] & (1u << (bit & 31)))
+		__PatchScan_Match(table, mem, size, pos, window, patches, hits);
+}
+
+/* Every signature of the given sets in one pass over the memory, reading
+ * it a word at a time. Signatures are matched against the memory as it
+ * was, hits holds one entry per patch. Returns the number of matches. */
+s32 PatchScan_Find(const u8* mem, u32 size, const IOSPatch* patches, u32 count, u32 sets, PatchScanHits* hits)
+{
+	PatchScanTable table;
+	u32 pos = 0, found = 0;
+
+	if (count > PATCHSCAN_MAX_PATTERNS)
+		return -1;
+
+	memset(&table, 0, sizeof(table));
+	memset(hits, 0, count * sizeof(PatchScanHits));
+
+	for (u32 i = 0; i < count; i++)
+	{
+		if (!(patches[i].set & sets))
+			continue;
+
+		if (patches[i].oldSize < 4)
+			return -1;
+
+		u32 key = load32(patches[i].old);
+		u32 bit = __PatchScan_Hash(key);
+
+		table.filter[bit >> 5] |= 1u << (bit & 31);
+		table.keys[table.count]  = key;
+		table.index[table.count] = i;
+		table.count++;
+	}
+
+	if (!table.count || size < 4)
+		return 0;
+
+	/* Up to the first aligned word */
+	for (; pos + 4 <= size && ((uintptr_t)(mem + pos) & 3); pos++)
+		__PatchScan_Check(&table, mem, size, pos, load32(mem + pos), patches, hits);
+
+	/* Each aligned word holds the start of four windows, the next word
+	 * completes them */
+	if (pos + 4 <= size)
+	{
+		u32 cur = load32(mem + pos);
+
+		for (; pos + 8 <= size; pos += 4)
+		{
+			u32 next = load32(mem + pos + 4);
+
+			__PatchScan_Check(&table, mem, size, pos,     cur,                        patches, hits);
+			__PatchScan_Check(&table, mem, size, pos + 1, (cur <<  8) | (next >> 24), patches, hits);
+			__PatchScan_Check(&table, mem, size, pos + 2, (cur << 16) | (next >> 16), patches, hits);
+			__PatchScan_Check(&table, mem, size, pos + 3, (cur << 24) | (next >>  8), patches, hits);
+
+			cur = next;
+		}
+	}
+
+	/* The last few windows */
+	for (; pos + 4 <= size; pos++)
+		__PatchScan_Check(&table, mem, size, pos, load32(mem + pos), patches, hits);
+
+	for (u32 i = 0; i < count; i++)
+		found += hits[i].hits;
+
+	return found;
+}
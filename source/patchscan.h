@@ -0,0 +1,36 @@
+#ifndef _PATCHSCAN_H_
+#define _PATCHSCAN_H_
+
+#include <gctypes.h>
+
+/* Constants */
+#define PATCHSCAN_MAX_PATTERNS	32
+#define PATCHSCAN_MAX_OFFSETS	16
+
+/* A signature and what to write over it, signatures are at least a word long */
+typedef struct
+{
+	const char* name;
+
+	const u8* old;
+	u32 oldSize;
+
+	const u8* patch;
+	u32 patchSize;
+	u32 patchOffset;
+
+	/* Which patch set it belongs to, see PatchScan_Find */
+	u32 set;
+} IOSPatch;
+
+/* Matches of one signature, offsets are from the start of the scanned memory */
+typedef struct
+{
+	u32 hits;
+	u32 offsets[PATCHSCAN_MAX_OFFSETS];
+} PatchScanHits;
+
+/* Prototypes */
+s32 PatchScan_Find(const u8* mem, u32 size, const IOSPatch* patches, u32 count, u32 sets, PatchScanHits* hits);
+
+#endif
@@ -0,0 +1,529 @@
+#include <stdio.h>
+#include <string.h>
+#include <ogcsys.h>
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
+#include <ogc/cond.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "malloc.h"
+#include "sectorcache.h"
+
+enum
+{
+	SECTORCACHE_THREAD_PRIORITY = 80,
+	SECTORCACHE_THREAD_STACK    = 0x4000,
+};
+
+/* Two extents, one being read while the other one is used */
+#define AHEAD_EXTENTS	2
+
+enum
+{
+	EXTENT_EMPTY,
+	EXTENT_QUEUED,
+	EXTENT_LOADING,
+	EXTENT_READY,
+};
+
+/* Sectors read ahead of a sequential reader */
+typedef struct
+{
+	u32 start;
+	u32 count;
+	u32 state;
+	u8* data;
+} SectorCacheExtent;
+
+/* A recently used block of SECTORCACHE_BLOCK_SECTORS sectors */
+typedef struct
+{
+	u32 block;
+	u32 used;
+	bool valid;
+	u8* data;
+} SectorCacheBlock;
+
+/* Sizes in bytes, for the next SectorCache_Init */
+static u32 gSize  = SECTORCACHE_DEFAULT_SIZE;
+static u32 gAhead = SECTORCACHE_DEFAULT_AHEAD;
+
+static SectorCacheIO gIO = NULL;
+static u32 gSectorSize = 0;
+static u32 gSectors = 0;
+static bool gReady = false;
+
+static SectorCacheBlock* gBlocks = NULL;
+static u32 gNumBlocks = 0;
+static u32 gClock = 0;
+
+static SectorCacheExtent gExtents[AHEAD_EXTENTS];
+static u32 gAheadSectors = 0;
+
+/* The start of the last extent the device couldn't read */
+static u32 gFailed = ~0;
+
+/* Where the last read ended, and how many reads in a row started there */
+static u32 gNext = ~0;
+static u32 gStreak = 0;
+
+/* gLock guards the cache, gDevLock the device */
+static mutex_t gLock    = LWP_MUTEX_NULL;
+static mutex_t gDevLock = LWP_MUTEX_NULL;
+static cond_t  gCond    = LWP_COND_NULL;
+
+static lwp_t gWorker = LWP_THREAD_NULL;
+static bool gQuit = false;
+
+static SectorCacheStats gStats;
+
+static inline bool __SectorCache_Overlaps(u32 start, u32 count, u32 sector, u32 len)
+{
+	return (u64)start < (u64)sector + len && (u64)sector < (u64)start + count;
+}
+
+/* The extent holding a sector, read or on its way */
+static SectorCacheExtent* __SectorCache_Extent(u32 sector)
+{
+	for (u32 i = 0; i < AHEAD_EXTENTS; i++)
+	{
+		SectorCacheExtent* ext = &gExtents[i];
+
+		if (ext->state != EXTENT_EMPTY && __SectorCache_Overlaps(ext->start, ext->count, sector, 1))
+			return ext;
+	}
+
+	return NULL;
+}
+
+static SectorCacheBlock* __SectorCache_Block(u32 block)
+{
+	for (u32 i = 0; i < gNumBlocks; i++)
+	{
+		if (gBlocks[i].valid && gBlocks[i].block == block)
+			return &gBlocks[i];
+	}
+
+	return NULL;
+}
+
+static void* __SectorCache_Worker(__attribute__((unused)) void* arg)
+{
+	LWP_MutexLock(gLock);
+
+	while (!gQuit)
+	{
+		SectorCacheExtent* ext = NULL;
+
+		/* The nearest one first, the reader needs it next */
+		for (u32 i = 0; i < AHEAD_EXTENTS; i++)
+		{
+			if (gExtents[i].state == EXTENT_QUEUED && (!ext || gExtents[i].start < ext->start))
+				ext = &gExtents[i];
+		}
+
+		if (!ext)
+		{
+			LWP_CondWait(gCond, gLock);
+			continue;
+		}
+
+		ext->state = EXTENT_LOADING;
+		u32 start = ext->start, count = ext->count;
+		LWP_MutexUnlock(gLock);
+
+		LWP_MutexLock(gDevLock);
+		bool ok = gIO(start, count, ext->data, false);
+		LWP_MutexUnlock(gDevLock);
+
+		/* Gone, or a bad spot; not asked for again */
+		LWP_MutexLock(gLock);
+		ext->state = ok ? EXTENT_READY : EXTENT_EMPTY;
+		if (!ok)
+			gFailed = start;
+		LWP_CondBroadcast(gCond);
+	}
+
+	LWP_MutexUnlock(gLock);
+
+	return NULL;
+}
+
+/* Queues the extents after a sequential read that aren't there yet, up
+ * to the end of the device. One that was read up to from is free again,
+ * so is one of an old stream. */
+static void __SectorCache_Prefetch(u32 from)
+{
+	u32 sector = from;
+
+	for (u32 i = 0; i < AHEAD_EXTENTS; i++)
+	{
+		SectorCacheExtent* ext = __SectorCache_Extent(sector);
+
+		if (!ext)
+		{
+			if (sector >= gSectors || sector == gFailed)
+				return;
+
+			for (u32 j = 0; j < AHEAD_EXTENTS && !ext; j++)
+			{
+				SectorCacheExtent* old = &gExtents[j];
+
+				if (old->state == EXTENT_EMPTY
+				|| (old->state == EXTENT_READY && (old->start + old->count <= from || old->start > sector)))
+					ext = old;
+			}
+
+			if (!ext)
+				return;
+
+			ext->start = sector;
+			ext->count = gAheadSectors;
+			if (ext->count > gSectors - sector)
+				ext->count = gSectors - sector;
+
+			ext->state = EXTENT_QUEUED;
+
+			gStats.prefetches++;
+			LWP_CondBroadcast(gCond);
+		}
+
+		sector = ext->start + ext->count;
+	}
+}
+
+/* The least recently used block, filled with the one holding a sector */
+static SectorCacheBlock* __SectorCache_Fill(u32 block)
+{
+	SectorCacheBlock* victim = &gBlocks[0];
+
+	for (u32 i = 0; i < gNumBlocks && victim->valid; i++)
+	{
+		if (!gBlocks[i].valid || gBlocks[i].used < victim->used)
+			victim = &gBlocks[i];
+	}
+
+	victim->valid = false;
+
+	/* The last block may be short, reads past the device never get here */
+	u32 start = block * SECTORCACHE_BLOCK_SECTORS, count = SECTORCACHE_BLOCK_SECTORS;
+	if (count > gSectors - start)
+		count = gSectors - start;
+
+	LWP_MutexLock(gDevLock);
+	bool ok = gIO(start, count, victim->data, false);
+	LWP_MutexUnlock(gDevLock);
+
+	if (!ok)
+		return NULL;
+
+	victim->block = block;
+	victim->valid = true;
+
+	return victim;
+}
+
+static void __SectorCache_Free(void)
+{
+	for (u32 i = 0; i < gNumBlocks; i++)
+		free(gBlocks[i].data);
+
+	free(gBlocks);
+	gBlocks = NULL;
+	gNumBlocks = 0;
+
+	for (u32 i = 0; i < AHEAD_EXTENTS; i++)
+	{
+		free(gExtents[i].data);
+		memset(&gExtents[i], 0, sizeof(SectorCacheExtent));
+	}
+
+	gAheadSectors = 0;
+
+	if (gCond != LWP_COND_NULL)
+	{
+		LWP_CondDestroy(gCond);
+		gCond = LWP_COND_NULL;
+	}
+
+	if (gDevLock != LWP_MUTEX_NULL)
+	{
+		LWP_MutexDestroy(gDevLock);
+		gDevLock = LWP_MUTEX_NULL;
+	}
+
+	if (gLock != LWP_MUTEX_NULL)
+	{
+		LWP_MutexDestroy(gLock);
+		gLock = LWP_MUTEX_NULL;
+	}
+}
+
+/* Takes effect right away if a device is open. Sizes are in bytes, 0
+ * turns the recently used blocks or reading ahead off. */
+void SectorCache_SetSize(u32 size, u32 ahead)
+{
+	gSize  = size;
+	gAhead = ahead;
+
+	if (gIO)
+		SectorCache_Init(gIO, gSectorSize, gSectors);
+}
+
+/* Without the memory for it reads and writes go straight to the device.
+ * Nothing is read past sectors, the size of the device. */
+s32 SectorCache_Init(SectorCacheIO io, u32 sectorSize, u32 sectors)
+{
+	SectorCache_Deinit();
+
+	gIO = io;
+	gSectorSize = sectorSize;
+	gSectors = sectors;
+	gNext = ~0;
+	gStreak = 0;
+	gFailed = ~0;
+
+	if (!io || !sectorSize || !sectors)
+		return -1;
+
+	u32 numBlocks = gSize / (SECTORCACHE_BLOCK_SECTORS * sectorSize);
+	u32 aheadSectors = gAhead / sectorSize;
+
+	if (!numBlocks && !aheadSectors)
+		return 0;
+
+	if (LWP_MutexInit(&gLock, false) < 0 || LWP_MutexInit(&gDevLock, false) < 0 || LWP_CondInit(&gCond) < 0)
+		goto err;
+
+	if (numBlocks)
+	{
+		gBlocks = calloc(numBlocks, sizeof(SectorCacheBlock));
+		if (!gBlocks)
+			goto err;
+
+		for (; gNumBlocks < numBlocks; gNumBlocks++)
+		{
+			gBlocks[gNumBlocks].data = memalign32(SECTORCACHE_BLOCK_SECTORS * sectorSize);
+			if (!gBlocks[gNumBlocks].data)
+				goto err;
+		}
+	}
+
+	if (aheadSectors)
+	{
+		for (u32 i = 0; i < AHEAD_EXTENTS; i++)
+		{
+			gExtents[i].data = memalign32(aheadSectors * sectorSize);
+			if (!gExtents[i].data)
+				goto err;
+		}
+
+		gQuit = false;
+
+		if (LWP_CreateThread(&gWorker, __SectorCache_Worker, NULL, NULL, SECTORCACHE_THREAD_STACK, SECTORCACHE_THREAD_PRIORITY) < 0)
+		{
+			gWorker = LWP_THREAD_NULL;
+			goto err;
+		}
+
+		gAheadSectors = aheadSectors;
+	}
+
+	gReady = true;
+	return 0;
+
+err:
+	__SectorCache_Free();
+	return -1;
+}
+
+void SectorCache_Deinit(void)
+{
+	if (gWorker != LWP_THREAD_NULL)
+	{
+		LWP_MutexLock(gLock);
+		gQuit = true;
+		LWP_CondBroadcast(gCond);
+		LWP_MutexUnlock(gLock);
+
+		LWP_JoinThread(gWorker, NULL);
+		gWorker = LWP_THREAD_NULL;
+	}
+
+	__SectorCache_Free();
+	gReady = false;
+	gIO = NULL;
+}
+
+bool SectorCache_Read(u32 sector, u32 count, u8* buffer)
+{
+	const u32 size = gSectorSize;
+	bool ok = true;
+	u32 pos = 0;
+
+	if (!gReady)
+		return gIO ? gIO(sector, count, buffer, false) : false;
+
+	/* Let the device turn it down */
+	if (sector >= gSectors || count > gSectors - sector)
+	{
+		LWP_MutexLock(gDevLock);
+		ok = gIO(sector, count, buffer, false);
+		LWP_MutexUnlock(gDevLock);
+
+		return ok;
+	}
+
+	LWP_MutexLock(gLock);
+
+	gStats.reads++;
+	gStats.sectors += count;
+
+	/* Two pages that happen to follow each other aren't a file yet */
+	gStreak = (sector == gNext) ? gStreak + 1 : 0;
+	bool sequential = gStreak >= 2 || __SectorCache_Extent(sector);
+
+	while (ok && pos < count)
+	{
+		u32 cur = sector + pos, left = count - pos, n;
+
+		SectorCacheExtent* ext = __SectorCache_Extent(cur);
+		if (ext)
+		{
+			/* Still on its way, look again once it's there */
+			if (ext->state != EXTENT_READY)
+			{
+				u64 start = gettime();
+				gStats.aheadWaits++;
+
+				while (ext->state == EXTENT_QUEUED || ext->state == EXTENT_LOADING)
+					LWP_CondWait(gCond, gLock);
+
+				gStats.waitTime += diff_usec(start, gettime());
+				continue;
+			}
+
+			n = ext->start + ext->count - cur;
+			if (n > left)
+				n = left;
+
+			memcpy(buffer + pos * size, ext->data + (cur - ext->start) * size, n * size);
+			gStats.aheadHits += n;
+			pos += n;
+			continue;
+		}
+
+		u32 block = cur / SECTORCACHE_BLOCK_SECTORS, offset = cur % SECTORCACHE_BLOCK_SECTORS;
+
+		SectorCacheBlock* blk = __SectorCache_Block(block);
+		if (blk)
+		{
+			n = SECTORCACHE_BLOCK_SECTORS - offset;
+			if (n > left)
+				n = left;
+
+			memcpy(buffer + pos * size, blk->data + offset * size, n * size);
+			blk->used = ++gClock;
+			gStats.recentHits += n;
+			pos += n;
+			continue;
+		}
+
+		/* Missing up to the next sector that is cached */
+		for (n = 1; n < left; n++)
+		{
+			u32 next = cur + n;
+
+			if (__SectorCache_Extent(next))
+				break;
+
+			if (!(next % SECTORCACHE_BLOCK_SECTORS) && __SectorCache_Block(next / SECTORCACHE_BLOCK_SECTORS))
+				break;
+		}
+
+		gStats.misses += n;
+
+		/* FAT and directory sectors come a page at a time and are read
+		 * again, so a miss inside one block keeps that block */
+		if (gNumBlocks && offset + n <= SECTORCACHE_BLOCK_SECTORS && (blk = __SectorCache_Fill(block)))
+		{
+			memcpy(buffer + pos * size, blk->data + offset * size, n * size);
+			blk->used = ++gClock;
+		}
+		else
+		{
+			LWP_MutexLock(gDevLock);
+			ok = gIO(cur, n, buffer + pos * size, false);
+			LWP_MutexUnlock(gDevLock);
+		}
+
+		pos += n;
+	}
+
+	gNext = sector + count;
+
+	if (ok && sequential && gAheadSectors)
+		__SectorCache_Prefetch(gNext);
+
+	LWP_MutexUnlock(gLock);
+
+	return ok;
+}
+
+/* Written through, nothing read ahead or kept may be older than the device */
+bool SectorCache_Write(u32 sector, u32 count, const u8* buffer)
+{
+	if (!gReady)
+		return gIO ? gIO(sector, count, (u8*)buffer, true) : false;
+
+	LWP_MutexLock(gLock);
+
+	gStats.writes++;
+
+	for (;;)
+	{
+		bool loading = false;
+
+		for (u32 i = 0; i < AHEAD_EXTENTS; i++)
+		{
+			SectorCacheExtent* ext = &gExtents[i];
+
+			if (ext->state == EXTENT_EMPTY || !__SectorCache_Overlaps(ext->start, ext->count, sector, count))
+				continue;
+
+			if (ext->state == EXTENT_LOADING)
+				loading = true;
+			else
+				ext->state = EXTENT_EMPTY;
+		}
+
+		if (!loading)
+			break;
+
+		LWP_CondWait(gCond, gLock);
+	}
+
+	for (u32 i = 0; i < gNumBlocks; i++)
+	{
+		if (gBlocks[i].valid && __SectorCache_Overlaps(gBlocks[i].block * SECTORCACHE_BLOCK_SECTORS, SECTORCACHE_BLOCK_SECTORS, sector, count))
+			gBlocks[i].valid = false;
+	}
+
+	LWP_MutexLock(gDevLock);
+	bool ok = gIO(sector, count, (u8*)buffer, true);
+	LWP_MutexUnlock(gDevLock);
+
+	LWP_MutexUnlock(gLock);
+
+	return ok;
+}
+
+void SectorCache_GetStats(SectorCacheStats* out)
+{
+	*out = gStats;
+}
+
+void SectorCache_ResetStats(void)
+{
+	memset(&gStats, 0, sizeof(gStats));
+}
@@ -0,0 +1,42 @@
+#ifndef _SECTORCACHE_H_
+#define _SECTORCACHE_H_
+
+#include <gctypes.h>
+
+/* Constants */
+#define SECTORCACHE_BLOCK_SECTORS	64			// One libfat cache page
+#define SECTORCACHE_DEFAULT_SIZE	0x80000
+#define SECTORCACHE_DEFAULT_AHEAD	0x40000
+
+/* Sector reads and writes of the device behind the cache */
+typedef bool (*SectorCacheIO)(u32 sector, u32 count, u8* buffer, bool write);
+
+/* Cache statistics, counted in sectors unless noted */
+typedef struct
+{
+	/* Requests, and the sectors read */
+	u32 reads;
+	u32 writes;
+	u64 sectors;
+
+	/* Read from recently used blocks, from an extent read ahead, or from the device */
+	u64 recentHits;
+	u64 aheadHits;
+	u64 misses;
+
+	/* Extents read ahead, reads that waited for one and how long, in microseconds */
+	u32 prefetches;
+	u32 aheadWaits;
+	u64 waitTime;
+} SectorCacheStats;
+
+/* Prototypes */
+void SectorCache_SetSize(u32 size, u32 ahead);
+s32  SectorCache_Init(SectorCacheIO io, u32 sectorSize, u32 sectors);
+void SectorCache_Deinit(void);
+bool SectorCache_Read(u32 sector, u32 count, u8* buffer);
+bool SectorCache_Write(u32 sector, u32 count, const u8* buffer);
+void SectorCache_GetStats(SectorCacheStats* out);
+void SectorCache_ResetStats(void);
+
+#endif
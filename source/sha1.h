@@ -1,6 +1,21 @@
 #ifndef _SHA1_H_
 #define _SHA1_H_
 
+#include <gctypes.h>
+
+/* Incremental hashing state */
+typedef struct
+{
+	u32 state[5];
+	u64 count;
+	u8  buffer[64];
+} SHA1_CTX;
+
+/* Prototypes */
+void SHA1Init(SHA1_CTX* context);
+void SHA1Update(SHA1_CTX* context, const void* data, u32 len);
+void SHA1Final(unsigned char digest[20], SHA1_CTX* context);
+
 void SHA1(unsigned char *, unsigned int, unsigned char *);
 int CompareHash(unsigned char* first, unsigned int firstSize, unsigned char* second, unsigned int secondSize);
 
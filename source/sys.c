@@ -6,6 +6,7 @@
 
 #include "sys.h"
 #include "nand.h"
+#include "title.h"
 #include "mini_seeprom.h"
 #include "malloc.h"
 #include "mload.h"
@@ -62,27 +63,17 @@ bool ES_CheckHasKoreanKey(void)
 
 bool isIOSstub(u8 ios_number)
 {
-	u32 tmd_size = 0;
-	tmd_view *ios_tmd;
+	const tmd_view *ios_tmd;
 
 	if ((boot2version >= 5) && (ios_number == 202 || ios_number == 222 || ios_number == 223 || ios_number == 224))
 		return true;
 
-	ES_GetTMDViewSize(0x0000000100000000ULL | ios_number, &tmd_size);
-	if (!tmd_size)
+	if (Title_LookupTMDView(0x0000000100000000ULL | ios_number, &ios_tmd) < 0)
 	{
-		// getting size failed. invalid or fake tmd for sure!
+		// getting the view failed. invalid or fake tmd for sure!
 		// gprintf("failed to get tmd for ios %d\n",ios_number);
 		return true;
 	}
-	ios_tmd = memalign32(tmd_size);
-	if (!ios_tmd)
-	{
-		// gprintf("failed to mem align the TMD struct!\n");
-		return true;
-	}
-	memset(ios_tmd, 0, tmd_size);
-	ES_GetTMDView(0x0000000100000000ULL | ios_number, (u8 *)ios_tmd, tmd_size);
 	// gprintf("IOS %d is rev %d(0x%x) with tmd size of %u and %u contents\n",ios_number,ios_tmd->title_version,ios_tmd->title_version,tmd_size,ios_tmd->num_contents);
 	/*Stubs have a few things in common:
 	- title version : it is mostly 65280 , or even better : in hex the last 2 digits are 0.
@@ -103,18 +94,15 @@ bool isIOSstub(u8 ios_number)
 		if ((ios_tmd->num_contents == 3) && (ios_tmd->contents[0].type == 1 && ios_tmd->contents[1].type == 0x8001 && ios_tmd->contents[2].type == 0x8001))
 		{
 			// gprintf("IOS %d is a stub\n",ios_number);
-			free(ios_tmd);
 			return true;
 		}
 		else
 		{
 			// gprintf("IOS %d is active\n",ios_number);
-			free(ios_tmd);
 			return false;
 		}
 	}
 	// gprintf("IOS %d is active\n",ios_number);
-	free(ios_tmd);
 	return false;
 }
 
@@ -1,7 +1,9 @@
 #ifndef _SYS_H_
 #define _SYS_H_
 
+#ifndef IS_WIIU
 #define IS_WIIU (*(vu16*)0xCD8005A0 == 0xCAFE)
+#endif
 
 extern u32 boot2version;
 
@@ -12,6 +12,32 @@
 #include "utils.h"
 #include "otp.h"
 #include "malloc.h"
+#include "arena.h"
+
+/* Scratch for buffers that don't outlive the helper using them */
+#define TITLE_SCRATCH_SIZE	0x8000
+
+static Arena gScratch;
+
+static Arena* __Title_Scratch(void)
+{
+	/* Without its memory it hands out heap blocks, so this is only tried again */
+	if (!gScratch.base)
+		Arena_Init(&gScratch, TITLE_SCRATCH_SIZE);
+
+	return &gScratch;
+}
+
+static void __Title_ScratchDone(void *ptr)
+{
+	Arena_Free(&gScratch, ptr);
+	Arena_Reset(&gScratch);
+}
+
+void Title_GetScratchStats(ArenaStats *out)
+{
+	Arena_GetStats(&gScratch, out);
+}
 
 s32 Title_ZeroSignature(signed_blob *p_sig)
 {
@@ -214,87 +240,225 @@ fail:
 	return ret;
 }
 
-s32 Title_GetVersion(u64 tid, u16 *outbuf)
+/* Session cache of stored TMDs and TMD views, failed lookups are kept too */
+typedef struct
+{
+	u64 tid;
+
+	signed_blob* tmd;
+	s32 tmdRet;
+	bool tmdLoaded;
+
+	tmd_view* view;
+	s32 viewRet;
+	bool viewLoaded;
+} TMDCacheEntry;
+
+static TMDCacheEntry* gTMDCache = NULL;
+static u32 gTMDCacheCount = 0;
+static u32 gTMDCacheSize = 0;
+
+static TMDCacheEntry* __Title_GetCacheEntry(u64 tid)
 {
-	signed_blob *p_tmd = NULL;
-	tmd      *tmd_data = NULL;
+	for (u32 i = 0; i < gTMDCacheCount; i++)
+	{
+		if (gTMDCache[i].tid == tid)
+			return &gTMDCache[i];
+	}
+
+	if (gTMDCacheCount == gTMDCacheSize)
+	{
+		u32 size = gTMDCacheSize ? gTMDCacheSize * 2 : 16;
+		TMDCacheEntry* cache = realloc(gTMDCache, size * sizeof(TMDCacheEntry));
+		if (!cache)
+			return NULL;
+
+		gTMDCache = cache;
+		gTMDCacheSize = size;
+	}
 
+	TMDCacheEntry* entry = &gTMDCache[gTMDCacheCount++];
+	memset(entry, 0, sizeof(TMDCacheEntry));
+	entry->tid = tid;
+
+	return entry;
+}
+
+static void __Title_FreeCacheEntry(TMDCacheEntry* entry)
+{
+	free(entry->tmd);
+	free(entry->view);
+}
+
+s32 Title_LookupTMD(u64 tid, const tmd** out)
+{
+	TMDCacheEntry* entry = __Title_GetCacheEntry(tid);
 	u32 len;
-	s32 ret;
 
-	/* Get title TMD */
-	ret = Title_GetTMD(tid, &p_tmd, &len);
-	if (ret < 0)
-		return ret;
+	if (!entry)
+		return -1;
 
-	/* Retrieve TMD info */
-	tmd_data = (tmd *)SIGNATURE_PAYLOAD(p_tmd);
+	if (!entry->tmdLoaded)
+	{
+		entry->tmdRet = Title_GetTMD(tid, &entry->tmd, &len);
 
-	/* Set values */
-	*outbuf = tmd_data->title_version;
+		/* Out of memory isn't an answer worth keeping */
+		entry->tmdLoaded = (entry->tmdRet != -1);
+	}
 
-	/* Free memory */
-	free(p_tmd);
+	if (entry->tmdRet < 0)
+		return entry->tmdRet;
 
+	*out = (const tmd*)SIGNATURE_PAYLOAD(entry->tmd);
 	return 0;
 }
 
-s32 Title_GetSysVersion(u64 tid, u64 *outbuf)
+s32 Title_LookupTMDView(u64 tid, const tmd_view** out)
 {
-	signed_blob *p_tmd = NULL;
-	tmd      *tmd_data = NULL;
-
+	TMDCacheEntry* entry = __Title_GetCacheEntry(tid);
 	u32 len;
-	s32 ret;
 
-	/* Get title TMD */
-	ret = Title_GetTMD(tid, &p_tmd, &len);
+	if (!entry)
+		return -1;
+
+	if (!entry->viewLoaded)
+	{
+		entry->viewRet = Title_GetTMDView(tid, &entry->view, &len);
+		entry->viewLoaded = (entry->viewRet != -1);
+	}
+
+	if (entry->viewRet < 0)
+		return entry->viewRet;
+
+	*out = entry->view;
+	return 0;
+}
+
+void Title_InvalidateTMD(u64 tid)
+{
+	for (u32 i = 0; i < gTMDCacheCount; i++)
+	{
+		if (gTMDCache[i].tid == tid)
+		{
+			__Title_FreeCacheEntry(&gTMDCache[i]);
+			gTMDCache[i] = gTMDCache[--gTMDCacheCount];
+			return;
+		}
+	}
+}
+
+void Title_FlushTMDCache(void)
+{
+	for (u32 i = 0; i < gTMDCacheCount; i++)
+		__Title_FreeCacheEntry(&gTMDCache[i]);
+
+	free(gTMDCache);
+	gTMDCache = NULL;
+	gTMDCacheCount = 0;
+	gTMDCacheSize = 0;
+}
+
+s32 Title_GetVersion(u64 tid, u16 *outbuf)
+{
+	const tmd *tmd_data = NULL;
+
+	s32 ret = Title_LookupTMD(tid, &tmd_data);
 	if (ret < 0)
 		return ret;
 
-	/* Retrieve TMD info */
-	tmd_data = (tmd *)SIGNATURE_PAYLOAD(p_tmd);
+	*outbuf = tmd_data->title_version;
 
-	/* Set values */
-	*outbuf = tmd_data->sys_version;
+	return 0;
+}
 
-	/* Free memory */
-	free(p_tmd);
+s32 Title_GetSysVersion(u64 tid, u64 *outbuf)
+{
+	const tmd *tmd_data = NULL;
+
+	s32 ret = Title_LookupTMD(tid, &tmd_data);
+	if (ret < 0)
+		return ret;
+
+	*outbuf = tmd_data->sys_version;
 
 	return 0;
 }
 
 s32 Title_GetSize(u64 tid, u32 *outbuf)
 {
-	signed_blob *p_tmd = NULL;
-	tmd      *tmd_data = NULL;
+	const tmd *tmd_data = NULL;
+	u32 cnt, size = 0;
 
-	u32 cnt, len, size = 0;
-	s32 ret;
+	s32 ret = Title_LookupTMD(tid, &tmd_data);
+	if (ret < 0)
+		return ret;
+
+	/* Calculate title size */
+	for (cnt = 0; cnt < tmd_data->num_contents; cnt++)
+		size += tmd_data->contents[cnt].size;
+
+	*outbuf = size;
+
+	return 0;
+}
+
+s32 Title_GetContents(u64 tid, const tmd_content **outbuf, u32 *outlen)
+{
+	const tmd *tmd_data = NULL;
 
-	/* Get title TMD */
-	ret = Title_GetTMD(tid, &p_tmd, &len);
+	s32 ret = Title_LookupTMD(tid, &tmd_data);
 	if (ret < 0)
 		return ret;
 
-	/* Retrieve TMD info */
-	tmd_data = (tmd *)SIGNATURE_PAYLOAD(p_tmd);
+	*outbuf = tmd_data->contents;
+	*outlen = tmd_data->num_contents;
 
-	/* Calculate title size */
-	for (cnt = 0; cnt < tmd_data->num_contents; cnt++) {
-		tmd_content *content = &tmd_data->contents[cnt];
+	return 0;
+}
+
+/* Every content of the installed TMD is really on the NAND, the TMD alone
+ * doesn't say so after a content was lost or deleted */
+bool Title_ContentsPresent(u64 tid, const tmd *installed)
+{
+	u32 count = 0, i, j;
+	bool present = false;
+
+	if (ES_GetStoredContentCnt(tid, &count) < 0 || count < installed->num_contents)
+		return false;
+
+	u32 *contents = memalign32(count * sizeof(u32));
+	if (!contents)
+		return false;
+
+	if (ES_GetStoredContents(tid, contents, count) < 0)
+		goto out;
 
-		/* Add content size */
-		size += content->size;
+	for (i = 0; i < installed->num_contents; i++)
+	{
+		for (j = 0; j < count && contents[j] != installed->contents[i].cid; j++)
+			;
+
+		if (j == count)
+			goto out;
 	}
 
-	/* Set values */
-	*outbuf = size;
+	present = true;
 
-	/* Free memory */
-	free(view);
+out:
+	free(contents);
+	return present;
+}
 
-	return 0;
+/* SHA-1 of the content records, the same for two TMDs with the same contents */
+void Title_ContentsHash(const tmd *tmd_data, sha1 hash)
+{
+	SHA1((u8 *)tmd_data->contents, tmd_data->num_contents * sizeof(tmd_content), hash);
+}
+
+void Title_FlushCaches(void)
+{
+	Title_FlushTMDCache();
+	Title_FlushSharedIndex();
 }
 
 s32 Title_GetIOSVersions(u8 **outbuf, u32 *outlen)
@@ -350,18 +514,21 @@ out:
 	return ret;
 }
 
-s32 Title_GetSharedContents(SharedContent** out, u32* count)
+static s32 __Title_GetSharedContents(Arena* arena, SharedContent** out, u32* count)
 {
 	if (!out || !count) return false;
 
 	u32 size;
-	SharedContent* buf = (SharedContent*)NANDLoadFile("/shared1/content.map", &size);
+	SharedContent* buf = (SharedContent*)(arena ? NANDLoadFileArena(arena, "/shared1/content.map", &size) : NANDLoadFile("/shared1/content.map", &size));
 
 	if (!buf)
 		return (s32)size;
 
 	else if (size % sizeof(SharedContent) != 0) {
-		free(buf);
+		if (arena)
+			Arena_Free(arena, buf);
+		else
+			free(buf);
 		return -996;
 	}
 
@@ -371,35 +538,158 @@ s32 Title_GetSharedContents(SharedContent** out, u32* count)
 	return 0;
 }
 
-bool Title_SharedContentPresent(tmd_content* content, SharedContent shared[], u32 count)
+s32 Title_GetSharedContents(SharedContent** out, u32* count)
 {
-	if (!shared || !content || !count)
-		return false;
+	return __Title_GetSharedContents(NULL, out, count);
+}
 
-	if (!(content->type & 0x8000))
-		return false;
+/* Session index of /shared1/content.map, open addressed on the hash */
+typedef struct
+{
+	sha1 hash;
+	bool used;
+} SharedIndexSlot;
+
+static struct
+{
+	SharedIndexSlot* slots;
+	u32 capacity;
+	u32 count;
+	bool loaded;
+} gSharedIndex;
+
+static u32 __Title_SharedIndexFind(const sha1 hash)
+{
+	u32 mask = gSharedIndex.capacity - 1;
+
+	/* A SHA-1 is as good a hash as any hash of it */
+	u32 i = ((hash[0] << 24) | (hash[1] << 16) | (hash[2] << 8) | hash[3]) & mask;
 
-	for (SharedContent* s_content = shared; s_content < shared + count; s_content++)
+	while (gSharedIndex.slots[i].used && memcmp(gSharedIndex.slots[i].hash, hash, sizeof(sha1)))
+		i = (i + 1) & mask;
+
+	return i;
+}
+
+static s32 __Title_SharedIndexResize(u32 capacity)
+{
+	SharedIndexSlot* old = gSharedIndex.slots;
+	u32 oldCapacity = gSharedIndex.capacity;
+
+	SharedIndexSlot* slots = calloc(capacity, sizeof(SharedIndexSlot));
+	if (!slots)
+		return -1;
+
+	gSharedIndex.slots = slots;
+	gSharedIndex.capacity = capacity;
+
+	for (u32 i = 0; i < oldCapacity; i++)
 	{
-		if (memcmp(s_content->hash, content->hash, sizeof(sha1)) == 0)
-			return true;
+		if (old[i].used)
+			gSharedIndex.slots[__Title_SharedIndexFind(old[i].hash)] = old[i];
 	}
 
-	return false;
+	free(old);
+	return 0;
+}
+
+static s32 __Title_SharedIndexInsert(const sha1 hash)
+{
+	/* Keep it at most half full */
+	if ((gSharedIndex.count + 1) * 2 > gSharedIndex.capacity)
+	{
+		if (__Title_SharedIndexResize(gSharedIndex.capacity ? gSharedIndex.capacity * 2 : 256) < 0)
+			return -1;
+	}
+
+	SharedIndexSlot* slot = &gSharedIndex.slots[__Title_SharedIndexFind(hash)];
+	if (!slot->used)
+	{
+		memcpy(slot->hash, hash, sizeof(sha1));
+		slot->used = true;
+		gSharedIndex.count++;
+	}
+
+	return 0;
+}
+
+void Title_FlushSharedIndex(void)
+{
+	free(gSharedIndex.slots);
+	memset(&gSharedIndex, 0, sizeof(gSharedIndex));
+}
+
+s32 Title_LoadSharedIndex(void)
+{
+	SharedContent* shared = NULL;
+	u32 count = 0, capacity = 256;
+
+	if (gSharedIndex.loaded)
+		return 0;
+
+	/* Only needed until the index is built */
+	s32 ret = __Title_GetSharedContents(__Title_Scratch(), &shared, &count);
+
+	/* No map yet, nothing is shared */
+	if (ret == -106)
+		ret = 0;
+
+	if (ret < 0)
+		return ret;
+
+	while (capacity < count * 2)
+		capacity *= 2;
+
+	Title_FlushSharedIndex();
+	ret = __Title_SharedIndexResize(capacity);
+
+	for (u32 i = 0; i < count && ret >= 0; i++)
+		ret = __Title_SharedIndexInsert(shared[i].hash);
+
+	__Title_ScratchDone(shared);
+
+	if (ret < 0)
+	{
+		Title_FlushSharedIndex();
+		return ret;
+	}
+
+	gSharedIndex.loaded = true;
+	return 0;
+}
+
+bool Title_SharedContentPresent(const tmd_content* content)
+{
+	if (!content || !(content->type & 0x8000))
+		return false;
+
+	if (Title_LoadSharedIndex() < 0 || !gSharedIndex.count)
+		return false;
+
+	return gSharedIndex.slots[__Title_SharedIndexFind(content->hash)].used;
+}
+
+void Title_AddSharedContent(const tmd_content* content)
+{
+	if (!content || !(content->type & 0x8000) || !gSharedIndex.loaded)
+		return;
+
+	/* Better to reload the map than to miss an entry */
+	if (__Title_SharedIndexInsert(content->hash) < 0)
+		Title_FlushSharedIndex();
 }
 
 bool Title_GetcIOSInfo(int IOS, cIOSInfo* out)
 {
 	u64 titleID = 0x0000000100000000ULL | IOS;
-	tmd_view* view = NULL;
-	u32 view_size = 0;
+	const tmd_view* view = NULL;
 	char path[ISFS_MAXPATH];
 	u32 size;
 	cIOSInfo* buf = NULL;
 
-	s32 ret = Title_GetTMDView(titleID, &view, &view_size);
+	s32 ret = Title_LookupTMDView(titleID, &view);
 	if (ret < 0)
-		return ret;
+		return false;
 
 	u32 content0 = 0;
 	for (int i = 0; i < view->num_contents; i++)
@@ -409,20 +699,19 @@ bool Title_GetcIOSInfo(int IOS, cIOSInfo* out)
 			break;
 		}
 	}
-	free(view);
 
 	sprintf(path, "/title/00000001/%08x/content/%08x.app", IOS, content0);
-	buf = (cIOSInfo*)NANDLoadFile(path, &size);
+	buf = (cIOSInfo*)NANDLoadFileArena(__Title_Scratch(), path, &size);
 
 	if (!buf || size != 0x40 || buf->hdr_magic != CIOS_INFO_MAGIC || buf->hdr_version != CIOS_INFO_VERSION)
 		goto fail;
 
 	*out = *buf;
-	free(buf);
+	__Title_ScratchDone(buf);
 	return true;
 
 fail:
-	free(buf);
+	__Title_ScratchDone(buf);
 	return false;
 }
 
@@ -3,6 +3,8 @@
 
 #include <ogc/es.h>
 
+#include "arena.h"
+
 /* Constants */
 #define BLOCK_SIZE	0x4000
 
@@ -48,10 +50,22 @@ s32 Title_GetTMD(u64, signed_blob **, u32 *);
 s32 Title_GetVersion(u64, u16 *);
 s32 Title_GetSysVersion(u64, u64 *);
 s32 Title_GetSize(u64, u32 *);
+s32 Title_GetContents(u64, const tmd_content **, u32 *);
+bool Title_ContentsPresent(u64, const tmd *);
+void Title_ContentsHash(const tmd *, sha1);
+s32 Title_LookupTMD(u64, const tmd **);
+s32 Title_LookupTMDView(u64, const tmd_view **);
+void Title_InvalidateTMD(u64);
+void Title_FlushTMDCache(void);
+void Title_FlushCaches(void);
 s32 Title_GetIOSVersions(u8 **, u32 *);
 s32 Title_GetSharedContents(SharedContent** out, u32* count);
-bool Title_SharedContentPresent(tmd_content* content, SharedContent shared[], u32 count);
+s32 Title_LoadSharedIndex(void);
+void Title_FlushSharedIndex(void);
+bool Title_SharedContentPresent(const tmd_content* content);
+void Title_AddSharedContent(const tmd_content* content);
 bool Title_GetcIOSInfo(int IOS, cIOSInfo*);
+void Title_GetScratchStats(ArenaStats *);
 
 void Title_SetupCommonKeys(void);
 
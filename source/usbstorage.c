@@ -27,10 +27,14 @@ distribution.
 -------------------------------------------------------------*/
 
 #include <gccore.h>
+#include <ogc/lwp_watchdog.h>
 #include <malloc.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "usbstorage.h"
+#include "sectorcache.h"
+
 /* IOCTL commands */
 #define UMS_BASE			(('U'<<24)|('M'<<16)|('S'<<8))
 #define USB_IOCTL_UMS_INIT	        	(UMS_BASE+0x1)
@@ -51,6 +55,15 @@ distribution.
 
 #define UMS_HEAPSIZE			0x1000
 
+/* Sectors per transfer: the largest is tried first and halved whenever the
+ * backend refuses it, down to the 32 it always took */
+#define UMS_MAX_TRANSFER		0x20000
+#define UMS_MIN_SECTORS			32
+
+/* IOS errors are small negative numbers, capacities that look negative are
+ * drives of 1 TiB or more */
+#define UMS_ERROR_MIN			-0x10000
+
 /* Variables */
 static char fs[] ATTRIBUTE_ALIGN(32) = "/dev/usb2";
 static char fs2[] ATTRIBUTE_ALIGN(32) = "/dev/usb/ehc";
@@ -59,6 +72,9 @@ static char fs3[] ATTRIBUTE_ALIGN(32) = "/dev/usb/usb123";
 static s32 hid = -1, fd = -1;
 static u32 sector_size;
 
+static u32 max_sectors;
+static USBStorageStats stats;
+
 s32 USBStorage_GetCapacity(u32 *_sector_size) {
     if (fd > 0) {
         s32 ret;
@@ -147,6 +163,19 @@ void USBStorage_Deinit(void) {
         IOS_Close(fd);
         fd = -1;
     }
+
+    /* The next device may take more or less */
+    max_sectors = 0;
+}
+
+void USBStorage_GetStats(USBStorageStats *out) {
+    *out = stats;
+    out->maxSectors = max_sectors;
+    out->sectorSize = sector_size;
+}
+
+void USBStorage_ResetStats(void) {
+    memset(&stats, 0, sizeof(stats));
 }
 
 s32 USBStorage_ReadSectors(u32 sector, u32 numSectors, void *buffer) {
@@ -313,51 +342,96 @@ s32 USBStorage_WBFS_SetFragList(void *p, int size)
 
 #define DEVICE_TYPE_WII_UMS (('W'<<24)|('U'<<16)|('M'<<8)|'S')
 
+static bool __ums_Transfer(u32 sector, u32 numSectors, u8 *buffer, bool write);
+
 bool umsio_Startup() {
-    return USBStorage_Init() == 0;
+    if (USBStorage_Init() != 0)
+        return false;
+
+    u32 sectors = USBStorage_GetCapacity(NULL);
+
+    /* Size unknown, the cache is left off */
+    if ((s32)sectors < 0 && (s32)sectors >= UMS_ERROR_MIN)
+        sectors = 0;
+
+    /* Straight to the device if there's no memory for the cache */
+    SectorCache_Init(__ums_Transfer, sector_size, sectors);
+    return true;
 }
 
 bool umsio_IsInserted() {
     return true; // allways true
 }
 
-bool umsio_ReadSectors(sec_t sector, sec_t numSectors, u8 *buffer) {
-    u32 cnt = 0;
+static u32 __ums_MaxSectors(void) {
+    if (!max_sectors) {
+        max_sectors = UMS_MAX_TRANSFER / (sector_size ? sector_size : 512);
+
+        if (max_sectors < UMS_MIN_SECTORS)
+            max_sectors = UMS_MIN_SECTORS;
+    }
+
+    return max_sectors;
+}
+
+static s32 __ums_Io(u32 sector, u32 sectors, u8 *buffer, bool write) {
+    u64 start = gettime();
     s32 ret;
-    /* Do reads */
-    while (cnt < numSectors) {
-        u32   sectors = (numSectors - cnt);
 
-        /* Read sectors is too big */
-        if (sectors > 32)
-            sectors = 32;
+    if (write)
+        ret = USBStorage_WriteSectors(sector, sectors, buffer);
+    else
+        ret = USBStorage_ReadSectors(sector, sectors, buffer);
 
-        /* USB read */
-        ret = USBStorage_ReadSectors(sector + cnt, sectors, &buffer[cnt*512]);
-        if (ret < 0)
-            return false;
+    u32 elapsed = diff_usec(start, gettime());
 
-        /* Increment counter */
-        cnt += sectors;
+    if (ret < 0)
+        return ret;
+
+    if (write) {
+        stats.writes++;
+        stats.sectorsWritten += sectors;
+        stats.writeTime += elapsed;
+    } else {
+        stats.reads++;
+        stats.sectorsRead += sectors;
+        stats.readTime += elapsed;
     }
 
-    return true;
+    return ret;
 }
 
-bool umsio_WriteSectors(sec_t sector, sec_t numSectors, const u8* buffer) {
+/* As few transfers as the backend allows. One it refuses is tried again
+ * with half the sectors, down to UMS_MIN_SECTORS, and the size that went
+ * through is kept; if none does it was an error, not the size. */
+static bool __ums_Transfer(u32 sector, u32 numSectors, u8 *buffer, bool write) {
     u32 cnt = 0;
     s32 ret;
 
-    /* Do writes */
     while (cnt < numSectors) {
         u32   sectors = (numSectors - cnt);
 
-        /* Write sectors is too big */
-        if (sectors > 32)
-            sectors = 32;
+        if (sectors > __ums_MaxSectors())
+            sectors = max_sectors;
+
+        ret = __ums_Io(sector + cnt, sectors, &buffer[cnt * sector_size], write);
+
+        if (ret < 0 && sectors > UMS_MIN_SECTORS) {
+            u32 smaller = sectors;
+
+            while (ret < 0 && smaller > UMS_MIN_SECTORS) {
+                smaller = (smaller / 2 > UMS_MIN_SECTORS) ? smaller / 2 : UMS_MIN_SECTORS;
+                ret = __ums_Io(sector + cnt, smaller, &buffer[cnt * sector_size], write);
+            }
+
+            if (ret >= 0) {
+                max_sectors = smaller;
+                stats.shrinks++;
+            }
+
+            sectors = smaller;
+        }
 
-        /* USB write */
-        ret = USBStorage_WriteSectors(sector + cnt, sectors, &buffer[cnt * 512]);
         if (ret < 0)
             return false;
 
@@ -368,11 +442,20 @@ bool umsio_WriteSectors(sec_t sector, sec_t numSectors, const u8* buffer) {
     return true;
 }
 
+bool umsio_ReadSectors(sec_t sector, sec_t numSectors, u8 *buffer) {
+    return SectorCache_Read(sector, numSectors, buffer);
+}
+
+bool umsio_WriteSectors(sec_t sector, sec_t numSectors, const u8* buffer) {
+    return SectorCache_Write(sector, numSectors, buffer);
+}
+
 bool umsio_ClearStatus(void) {
     return true;
 }
 
 bool umsio_Shutdown() {
+    SectorCache_Deinit();
     USBStorage_Deinit();
     return true;
 }
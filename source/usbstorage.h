@@ -4,6 +4,25 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+    /* Transfers through __io_wiiums */
+    typedef struct
+    {
+        /* Sectors per transfer in use, lowered when the device refuses one */
+        u32 maxSectors;
+        u32 sectorSize;
+
+        /* Transfers, sectors and the time spent in them, in microseconds */
+        u32 reads;
+        u32 writes;
+        u64 sectorsRead;
+        u64 sectorsWritten;
+        u64 readTime;
+        u64 writeTime;
+
+        /* Transfers tried again with fewer sectors */
+        u32 shrinks;
+    } USBStorageStats;
+
     /* Prototypes */
     s32  USBStorage_GetCapacity(u32 *);
     s32  USBStorage_Init(void);
@@ -11,6 +30,8 @@ extern "C" {
     s32 USBStorage_Watchdog(u32 on_off);
     s32  USBStorage_ReadSectors(u32, u32, void *);
     s32  USBStorage_WriteSectors(u32, u32, const void *);
+    void USBStorage_GetStats(USBStorageStats *);
+    void USBStorage_ResetStats(void);
     
 	s32 USBStorage_WBFS_Open(char *buf_id);
 	s32 USBStorage_WBFS_Read(u32 woffset, u32 len, void *buffer);
@@ -22,6 +22,11 @@
 #include "globals.h"
 #include "iospatch.h"
 #include "fileops.h"
+#include "wadpipe.h"
+#include "wad.h"
+#include "wadplan.h"
+#include "patchcache.h"
+#include "sectorcache.h"
 
 // Globals
 CONFIG gConfig;
@@ -32,6 +37,7 @@ extern u32 WaitButtons (void);
 void CheckPassword (void);
 void SetDefaultConfig (void);
 int ReadConfigFile (void);
+void SetPatchPaths (void);
 int GetIntParam (char *inputStr);
 int GetStartupPath (char *startupPath, char *inputStr);
 int GetStringParam (char *outParam, char *inputStr, int maxChars);
@@ -201,6 +207,14 @@ int main(int argc, char **argv)
 
 	// Read the config file
 	ReadConfigFile();
+	WadPipe_SetDepth(gConfig.pipelineDepth);
+	Wad_SetVerify(gConfig.verifyContents);
+	WadPlan_SetSkipInstalled(gConfig.skipInstalled);
+	Wad_SetSkipIdentical(gConfig.skipIdentical);
+	SectorCache_SetSize(gConfig.usbCache * 1024, gConfig.usbReadAhead * 1024);
+
+	if (gConfig.patchCache || gConfig.recordIOS)
+		SetPatchPaths();
 
 	// Check password
 	CheckPassword();
@@ -310,6 +324,64 @@ int ReadConfigFile()
 					}
 				}
 			}
+
+			// Number of buffers used to stream WAD contents
+			else if (strncmp (tmpStr, "PipelineDepth", 13) == 0)
+			{
+				gConfig.pipelineDepth = GetIntParam(tmpStr);
+			}
+
+			// Check content hashes while installing
+			else if (strncmp (tmpStr, "VerifyContents", 14) == 0)
+			{
+				gConfig.verifyContents = GetIntParam(tmpStr);
+			}
+
+			// Leave WADs that are already installed alone in batches
+			else if (strncmp (tmpStr, "SkipInstalled", 13) == 0)
+			{
+				gConfig.skipInstalled = GetIntParam(tmpStr);
+			}
+
+			// Run batches without stopping until the results
+			else if (strncmp (tmpStr, "Unattended", 10) == 0)
+			{
+				gConfig.unattended = GetIntParam(tmpStr);
+			}
+
+			// Only write contents that differ from the installed ones
+			else if (strncmp (tmpStr, "SkipIdentical", 13) == 0)
+			{
+				gConfig.skipIdentical = GetIntParam(tmpStr);
+			}
+
+			// Remember where the IOS patches were found
+			else if (strncmp (tmpStr, "PatchCache", 10) == 0)
+			{
+				gConfig.patchCache = GetIntParam(tmpStr);
+			}
+
+			// Keep a copy of IOS memory for the host test bench
+			else if (strncmp (tmpStr, "RecordIOS", 9) == 0)
+			{
+				gConfig.recordIOS = GetIntParam(tmpStr);
+			}
+
+			// Recently used USB 2.0 sectors, in KiB
+			else if (strncmp (tmpStr, "USBCache", 8) == 0)
+			{
+				gConfig.usbCache = GetIntParam(tmpStr);
+				if (gConfig.usbCache < 0)
+					gConfig.usbCache = 0;
+			}
+
+			// USB 2.0 sectors read ahead of a file, in KiB
+			else if (strncmp (tmpStr, "USBReadAhead", 12) == 0)
+			{
+				gConfig.usbReadAhead = GetIntParam(tmpStr);
+				if (gConfig.usbReadAhead < 0)
+					gConfig.usbReadAhead = 0;
+			}
 		}
 	} // EndWhile
 			
@@ -320,6 +392,31 @@ int ReadConfigFile()
 } // ReadConfig
 
 
+// IOS patch locations go next to the config, on the first device with a /wad folder
+void SetPatchPaths (void)
+{
+	char path[128];
+	s32 i;
+
+	for (i = 0; i < FatGetDeviceCount(); i++)
+	{
+		snprintf(path, sizeof(path), "%s:%s", FatGetDevicePrefix(i), WAD_ROOT_DIRECTORY);
+		if (FSOPFolderExists(path))
+		{
+			if (gConfig.recordIOS)
+				IOSPATCH_SetRecordDir(path);
+
+			if (gConfig.patchCache)
+			{
+				snprintf(path, sizeof(path), "%s:%s", FatGetDevicePrefix(i), WM_PATCH_CACHE_PATH);
+				PatchCache_SetPath(path);
+			}
+			return;
+		}
+	}
+} // SetPatchPaths
+
+
 void SetDefaultConfig (void)
 {
 	// Default password is NULL or no password
@@ -331,6 +428,15 @@ void SetDefaultConfig (void)
 	gConfig.cIOSVersion = CIOS_VERSION_INVALID;            // Means that user has to select later
 	gConfig.fatDeviceIndex = FAT_DEVICE_INDEX_INVALID;     // Means that user has to select
 	gConfig.nandDeviceIndex = NAND_DEVICE_INDEX_INVALID;   // Means that user has to select
+	gConfig.pipelineDepth = WADPIPE_DEFAULT_DEPTH;         // Double buffered content streaming
+	gConfig.verifyContents = 0;                            // Leave hash checks to ES
+	gConfig.skipInstalled = 0;                             // Batches install everything again
+	gConfig.unattended = 0;                                // Ask before starting a batch
+	gConfig.skipIdentical = 0;                             // Reinstalls write every content again
+	gConfig.patchCache = 1;                                // IOS patches from the last scan of the same IOS
+	gConfig.recordIOS = 0;                                 // IOS memory is only dumped on request
+	gConfig.usbCache = SECTORCACHE_DEFAULT_SIZE / 1024;    // FAT and directory pages kept
+	gConfig.usbReadAhead = SECTORCACHE_DEFAULT_AHEAD / 1024; // Per extent, two are kept
 
 } // SetDefaultConfig
 
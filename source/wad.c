@@ -5,6 +5,7 @@
 #include <ogc/pad.h>
 #include <ogc/es.h>
 #include <ogc/aes.h>
+#include <ogc/lwp.h>
 
 #include "sys.h"
 #include "title.h"
@@ -20,6 +21,9 @@
 #include "menu.h"
 #include "iospatch.h"
 #include "malloc.h"
+#include "wadpipe.h"
+#include "arena.h"
+#include "globals.h"
 
 // Turn upper and lower into a full title ID
 #define TITLE_ID(x,y)		(((u64)(x) << 32) | (y))
@@ -72,6 +76,9 @@ const char* VersionLookupTable[7][20] =
 u32 WaitButtons(void);
 static u32 gPriiloaderSize = 0;
 static bool gForcedInstall = false;
+static bool gVerifyContents = false;
+static bool gSkipIdentical = false;
+static void (*gProgress)(u32 done, u32 total) = NULL;
 
 u32 be32(const u8 *p)
 {
@@ -98,69 +105,53 @@ static void DecEncTxtBuffer(char* buffer)
 u64 get_title_ios(u64 title) {
 	s32 ret, fd;
 	static char filepath[256] ATTRIBUTE_ALIGN(32);
+	u64 sys_version;
+
+	// Normal versions of IOS won't have a problem, and the TMD stays cached for the session
+	if (Title_GetSysVersion(title, &sys_version) >= 0)
+		return sys_version;
 
 	// Check to see if title exists
 	if (ES_GetDataDir(title, filepath) >= 0 ) {
-		u32 tmd_size = 0;
-		static u8 tmd_buf[MAX_SIGNED_TMD_SIZE] ATTRIBUTE_ALIGN(32);
-
-		ret = ES_GetStoredTMDSize(title, &tmd_size);
-		if (ret < 0){
-			// If we fail to use the ES function, try reading manually
-			// This is a workaround added since some IOS (like 21) don't like our
-			// call to ES_GetStoredTMDSize
+		static u8 tmd_buf[8] ATTRIBUTE_ALIGN(32);
 
-			//printf("Error! ES_GetStoredTMDSize: %d\n", ret);
+		// If we fail to use the ES function, try reading manually
+		// This is a workaround added since some IOS (like 21) don't like our
+		// call to ES_GetStoredTMDSize
 
-			sprintf(filepath, "/title/%08x/%08x/content/title.tmd", TITLE_UPPER(title), TITLE_LOWER(title));
+		sprintf(filepath, "/title/%08x/%08x/content/title.tmd", TITLE_UPPER(title), TITLE_LOWER(title));
 
-			ret = ISFS_Open(filepath, ISFS_OPEN_READ);
-			if (ret <= 0)
-			{
-				//printf("Error! ISFS_Open (ret = %d)\n", ret);
-				return 0;
-			}
-
-			fd = ret;
-
-			ret = ISFS_Seek(fd, 0x184, 0);
-			if (ret < 0)
-			{
-				//printf("Error! ISFS_Seek (ret = %d)\n", ret);
-				return 0;
-			}
-
-			ret = ISFS_Read(fd,tmd_buf,8);
-			if (ret < 0)
-			{
-				//printf("Error! ISFS_Read (ret = %d)\n", ret);
-				return 0;
-			}
-
-			ret = ISFS_Close(fd);
-			if (ret < 0)
-			{
-				//printf("Error! ISFS_Close (ret = %d)\n", ret);
-				return 0;
-			}
+		ret = ISFS_Open(filepath, ISFS_OPEN_READ);
+		if (ret <= 0)
+		{
+			//printf("Error! ISFS_Open (ret = %d)\n", ret);
+			return 0;
+		}
 
-			return be64(tmd_buf);
+		fd = ret;
 
-		} else {
-			// Normal versions of IOS won't have a problem, so we do things the "right" way.
+		ret = ISFS_Seek(fd, 0x184, 0);
+		if (ret < 0)
+		{
+			//printf("Error! ISFS_Seek (ret = %d)\n", ret);
+			return 0;
+		}
 
-			// Some of this code adapted from bushing's title_lister.c
-			signed_blob *s_tmd = (signed_blob *)tmd_buf;
-			ret = ES_GetStoredTMD(title, s_tmd, tmd_size);
-			if (ret < 0){
-				//printf("Error! ES_GetStoredTMD: %d\n", ret);
-				return -1;
-			}
-			tmd *t = SIGNATURE_PAYLOAD(s_tmd);
-			return t->sys_version;
+		ret = ISFS_Read(fd,tmd_buf,8);
+		if (ret < 0)
+		{
+			//printf("Error! ISFS_Read (ret = %d)\n", ret);
+			return 0;
 		}
 
+		ret = ISFS_Close(fd);
+		if (ret < 0)
+		{
+			//printf("Error! ISFS_Close (ret = %d)\n", ret);
+			return 0;
+		}
 
+		return be64(tmd_buf);
 	}
 	return 0;
 }
@@ -236,6 +227,102 @@ s32 GetSysMenuRegion(u16* version, char* region)
 	return 0;
 }
 
+/* Titles whose IOS must not be stubbed or removed, resolved once per session */
+enum
+{
+	PROTECT_SYSMENU_IOS       = 1 << 0,
+	PROTECT_EULA_IOS          = 1 << 1,
+	PROTECT_RGNSEL_IOS        = 1 << 2,
+	PROTECT_HBC_IOS           = 1 << 3,
+	PROTECT_REGION_EULA_IOS   = 1 << 4,
+	PROTECT_REGION_RGNSEL_IOS = 1 << 5,
+};
+
+static const u32 HBCTitles[] = { 0x48415858, 0x4A4F4449, 0xAF1BF516, 0x4C554C5A, 0x4F484243 };
+static const char EULARegions[] = { 'E', 'P', 'J', 'K' };
+
+static struct
+{
+	bool resolved;
+	u64 sysMenuIOS;
+	char region;
+
+	/* Flags by IOS number */
+	u8 ios[256];
+} gPolicy;
+
+static void __Wad_ProtectIOS(u64 ios, u8 flags)
+{
+	if (TITLE_UPPER(ios) == 1 && TITLE_LOWER(ios) < 256)
+		gPolicy.ios[TITLE_LOWER(ios)] |= flags;
+}
+
+static void __Wad_ResolvePolicy(void)
+{
+	if (gPolicy.resolved)
+		return;
+
+	memset(&gPolicy, 0, sizeof(gPolicy));
+
+	gPolicy.sysMenuIOS = get_title_ios(TITLE_ID(1, 2));
+	__Wad_ProtectIOS(gPolicy.sysMenuIOS, PROTECT_SYSMENU_IOS);
+
+	for (u32 i = 0; i < sizeof(EULARegions); i++)
+	{
+		__Wad_ProtectIOS(get_title_ios(TITLE_ID(0x10008, 0x48414B00 | EULARegions[i])), PROTECT_EULA_IOS);
+		__Wad_ProtectIOS(get_title_ios(TITLE_ID(0x10008, 0x48414C00 | EULARegions[i])), PROTECT_RGNSEL_IOS);
+	}
+
+	for (u32 i = 0; i < sizeof(HBCTitles) / sizeof(HBCTitles[0]); i++)
+		__Wad_ProtectIOS(get_title_ios(TITLE_ID(0x10001, HBCTitles[i])), PROTECT_HBC_IOS);
+
+	gPolicy.resolved = true;
+}
+
+/* The region is only needed to uninstall, and reading it can fail */
+static char __Wad_GetPolicyRegion(void)
+{
+	__Wad_ResolvePolicy();
+
+	if (!gPolicy.region)
+	{
+		GetSysMenuRegion(NULL, &gPolicy.region);
+
+		if (gPolicy.region)
+		{
+			__Wad_ProtectIOS(get_title_ios(TITLE_ID(0x10008, 0x48414B00 | gPolicy.region)), PROTECT_REGION_EULA_IOS);
+			__Wad_ProtectIOS(get_title_ios(TITLE_ID(0x10008, 0x48414C00 | gPolicy.region)), PROTECT_REGION_RGNSEL_IOS);
+		}
+	}
+
+	return gPolicy.region;
+}
+
+static u8 __Wad_GetProtection(u64 tid)
+{
+	__Wad_ResolvePolicy();
+
+	if (TITLE_UPPER(tid) != 1 || TITLE_LOWER(tid) > 255)
+		return 0;
+
+	return gPolicy.ios[TITLE_LOWER(tid)];
+}
+
+void Wad_FlushPolicy(void)
+{
+	gPolicy.resolved = false;
+}
+
+/* Drops whatever we know about a title that was just installed or removed */
+static void __Wad_TitleChanged(u64 tid)
+{
+	Title_InvalidateTMD(tid);
+
+	/* Only other titles decide which IOS are protected */
+	if (TITLE_UPPER(tid) != 1 || tid == TITLE_ID(1, 2))
+		Wad_FlushPolicy();
+}
+
 bool VersionIsOriginal(u16 version)
 {
 	s32 i;
@@ -276,36 +363,18 @@ static u32 GetSysMenuBootContent(void)
 {
 	s32 ret;
 	u32 cid = 0;
-	u32 size = 0;
-	signed_blob *s_tmd = NULL;
-
-	ret = ES_GetStoredTMDSize(0x100000002LL, &size);
-	if (!size)
-	{
-		printf("Error! ES_GetStoredTMDSize failed (ret=%i)\n", ret);
-		return 0;
-	}
+	const tmd *p_tmd = NULL;
 
-	s_tmd = memalign32(size);
-	if (!s_tmd)
-	{
-		printf("Error! Memory allocation failed!\n");
-		return 0;
-	}
-
-	ret = ES_GetStoredTMD(0x100000002LL, s_tmd, size);
+	ret = Title_LookupTMD(0x100000002LL, &p_tmd);
 	if (ret < 0)
 	{
 		printf("Error! ES_GetStoredTMD failed (ret=%i)\n", ret);
-		free(s_tmd);
 		return 0;
 	}
 
-	tmd *p_tmd = SIGNATURE_PAYLOAD(s_tmd);
-
 	for (int i = 0; i < p_tmd->num_contents; i++)
 	{
-		tmd_content* content = &p_tmd->contents[i];
+		const tmd_content* content = &p_tmd->contents[i];
 		if (content->index == p_tmd->boot_index)
 		{
 			cid = content->cid;
@@ -313,7 +382,6 @@ static u32 GetSysMenuBootContent(void)
 		}
 	}
 
-	free(s_tmd);
 	if (!cid) printf("Error! Cannot find system menu boot content!\n");
 
 	return cid;
@@ -483,25 +551,8 @@ static bool CompareHashes(bool priiloader)
 	if (!priiloader)
 		GetSysMenuExecPath(dstPath, true);
 
-	u32 sizeA = 0;
-	u32 sizeB = 0;
-	u8* dataA = NANDLoadFile(srcPath, &sizeA);
-	if (!dataA)
-		return false;
-
-	u8* dataB = NANDLoadFile(dstPath, &sizeB);
-	if (!dataB)
-	{
-		free(dataA);
-		return false;
-	}
-
-	bool ret = (sizeA == sizeB) && !CompareHash(dataA, sizeA, dataB, sizeB);
-
-	free(dataA);
-	free(dataB);
-
-	return ret;
+	/* Streamed side by side, neither file is ever held in full */
+	return NANDCompareFiles(srcPath, dstPath) == 0;
 }
 
 /* 'WAD Header' structure */
@@ -523,40 +574,6 @@ typedef struct {
 	u32 footer_len;
 } ATTRIBUTE_PACKED wadHeader;
 
-/* Variables */
-static u8 wadBuffer[BLOCK_SIZE] ATTRIBUTE_ALIGN(32);
-
-s32 __Wad_GetTitleID(FILE *fp, wadHeader *header, u64 *tid)
-{
-	signed_blob *p_tik    = NULL;
-	tik         *tik_data = NULL;
-
-	u32 offset = 0;
-	s32 ret;
-
-	/* Ticket offset */
-	offset += round_up(header->header_len, 64);
-	offset += round_up(header->certs_len,  64);
-	offset += round_up(header->crl_len,    64);
-
-	/* Read ticket */
-	ret = FSOPReadOpenFileA(fp, (void*)&p_tik, offset, header->tik_len);
-	if (ret != 1)
-		goto out;
-
-	/* Ticket data */
-	tik_data = (tik *)SIGNATURE_PAYLOAD(p_tik);
-
-	/* Copy title ID */
-	*tid = tik_data->titleid;
-
-out:
-	/* Free memory */
-	free(p_tik);
-
-	return ret;
-}
-
 bool __Wad_FixTicket(signed_blob *s_tik)
 {
 	tik* p_tik = SIGNATURE_PAYLOAD(s_tik);
@@ -595,6 +612,24 @@ bool __Wad_FixTicket(signed_blob *s_tik)
 	return fixvWiiKey;
 }
 
+/* Decrypts the title key with the Wii common key, false if the ticket uses another one */
+static bool __Wad_GetTitleKey(signed_blob *s_tik, aeskey titleKey)
+{
+	tik* ticket = (tik*)SIGNATURE_PAYLOAD(s_tik);
+	u8 commonKeyIndex = ((u8*)s_tik)[0x1F1];
+
+	/* Title ID in big endian, whatever the host is */
+	__aligned(0x10)
+	u8 iv[16] = {};
+	for (int i = 0; i < 8; i++)
+		iv[i] = ticket->titleid >> (56 - (i * 8));
+
+	memcpy(titleKey, ticket->cipher_title_key, sizeof(aeskey));
+	AES_Decrypt(WiiCommonKey, sizeof(aeskey), iv, sizeof(iv), titleKey, titleKey, sizeof(aeskey));
+
+	return commonKeyIndex == 0;
+}
+
 bool __Wad_VerifyHeader(wadHeader* header)
 {
 	return
@@ -634,18 +669,291 @@ const char* wad_strerror(int ec)
 // skip the problematic checks for region changing.
 bool skipRegionSafetyCheck = false;
 
-s32 Wad_Install(FILE *fp)
+void Wad_SetVerify(bool enabled)
+{
+	gVerifyContents = enabled;
+}
+
+void Wad_SetSkipIdentical(bool enabled)
+{
+	gSkipIdentical = enabled;
+}
+
+/* Same content, byte for byte, already in the installed TMD */
+static bool __Wad_ContentInstalled(const tmd *installed, const tmd_content *content)
+{
+	for (u32 i = 0; i < installed->num_contents; i++)
+	{
+		const tmd_content *old = &installed->contents[i];
+
+		if (old->cid == content->cid)
+			return old->index == content->index && old->type == content->type && old->size == content->size
+				&& !memcmp(old->hash, content->hash, sizeof(sha1));
+	}
+
+	return false;
+}
+
+/* Called after every content of an install */
+void Wad_SetProgress(void (*progress)(u32 done, u32 total))
+{
+	gProgress = progress;
+}
+
+/* A WAD read up to its contents */
+typedef struct
+{
+	FILE* fp;
+	FSOPStream stream;
+
+	/* Stream buffer and metadata come from here, reset once the WAD is done */
+	Arena *pool;
+
+	/* Header through TMD in one aligned block, the rest point into it */
+	u8          *arena;
+	wadHeader   *header;
+	signed_blob *certs, *crl, *tik, *tmd;
+
+	/* First content */
+	u32 offset;
+	s32 ret;
+} WadMeta;
+
+/* Anything bigger isn't a WAD, a TMD with 512 contents is under 20KB */
+#define WAD_META_MAX	0x40000
+
+/* Room for the metadata of a WAD next to its stream buffer */
+#define WAD_META_ARENA	0x10000
+
+/* One arena for the WAD being installed, one for the next being read. They
+ * are kept for the session, so a long batch doesn't churn the heap. */
+#define WAD_ARENAS		2
+
+static Arena gArenas[WAD_ARENAS];
+static bool  gArenaBusy[WAD_ARENAS];
+
+/* Never initialised, everything goes to the heap when both are taken */
+static Arena gNoArena;
+
+/* Main thread only, the prefetch gets its arena before it starts */
+static void __Wad_TakeArena(WadMeta *meta)
+{
+	meta->pool = &gNoArena;
+
+	for (u32 i = 0; i < WAD_ARENAS; i++)
+	{
+		if (gArenaBusy[i])
+			continue;
+
+		if (!gArenas[i].base && Arena_Init(&gArenas[i], FSOP_STREAM_BUFFER_SIZE + WAD_META_ARENA) < 0)
+			return;
+
+		gArenaBusy[i] = true;
+		meta->pool = &gArenas[i];
+		return;
+	}
+}
+
+static void __Wad_ReleaseArena(WadMeta *meta)
+{
+	for (u32 i = 0; i < WAD_ARENAS; i++)
+	{
+		if (meta->pool == &gArenas[i])
+		{
+			Arena_Reset(&gArenas[i]);
+			gArenaBusy[i] = false;
+		}
+	}
+
+	meta->pool = NULL;
+}
+
+void Wad_FreeArenas(void)
+{
+	for (u32 i = 0; i < WAD_ARENAS; i++)
+	{
+		if (!gArenaBusy[i])
+			Arena_Destroy(&gArenas[i]);
+	}
+}
+
+/* Totals of the WAD arenas, fragmentation shows as padding and spills */
+void Wad_GetArenaStats(ArenaStats *out)
+{
+	ArenaStats stats;
+
+	memset(out, 0, sizeof(ArenaStats));
+
+	for (u32 i = 0; i < WAD_ARENAS; i++)
+	{
+		Arena_GetStats(&gArenas[i], &stats);
+		Arena_AddStats(out, &stats);
+	}
+
+	Arena_GetStats(&gNoArena, &stats);
+	Arena_AddStats(out, &stats);
+}
+
+void Wad_ResetArenaStats(void)
+{
+	for (u32 i = 0; i < WAD_ARENAS; i++)
+	{
+		ArenaStats *stats = &gArenas[i].stats;
+
+		stats->peak = stats->used;
+		stats->allocs = stats->resets = stats->spills = stats->spillBytes = 0;
+	}
+
+	memset(&gNoArena.stats, 0, sizeof(ArenaStats));
+}
+
+/* The header says where everything is, the rest is read in one go */
+static s32 __Wad_ReadMeta(FILE *fp, WadMeta *meta, u32 bufferSize)
+{
+	__aligned(0x20)
+	wadHeader header;
+	s32 ret;
+
+	meta->fp = fp;
+
+	if (!meta->pool)
+		__Wad_TakeArena(meta);
+
+	void *buffer = Arena_Alloc(meta->pool, bufferSize, 32);
+	if (!buffer)
+		return -1;
+
+	FSOPStreamAttach(&meta->stream, fp, buffer, bufferSize);
+
+	ret = FSOPStreamRead(&meta->stream, &header, 0, sizeof(wadHeader));
+	if (ret != 1)
+		return -996;
+
+	if (!__Wad_VerifyHeader(&header)
+	||  header.certs_len > WAD_META_MAX || header.crl_len > WAD_META_MAX
+	||  header.tik_len   > WAD_META_MAX || header.tmd_len > WAD_META_MAX)
+		return ES_EINVAL;
+
+	/* Sections start 64 byte aligned, so every view stays 32 byte aligned */
+	u32 certs = round_up(header.header_len, 64);
+	u32 crl   = certs + round_up(header.certs_len, 64);
+	u32 tik   = crl   + round_up(header.crl_len,   64);
+	u32 tmd   = tik   + round_up(header.tik_len,   64);
+	u32 end   = tmd   + header.tmd_len;
+
+	if (end > WAD_META_MAX)
+		return ES_EINVAL;
+
+	meta->arena = Arena_Alloc(meta->pool, end, 64);
+	if (!meta->arena)
+		return -1;
+
+	ret = FSOPStreamRead(&meta->stream, meta->arena, 0, end);
+	if (ret != 1)
+		return -996;
+
+	meta->header = (wadHeader *)meta->arena;
+	meta->certs  = (signed_blob *)(meta->arena + certs);
+	meta->crl    = header.crl_len ? (signed_blob *)(meta->arena + crl) : NULL;
+	meta->tik    = (signed_blob *)(meta->arena + tik);
+	meta->tmd    = (signed_blob *)(meta->arena + tmd);
+
+	meta->offset = tmd + round_up(header.tmd_len, 64);
+	return 0;
+}
+
+static void __Wad_FreeMeta(WadMeta *meta)
+{
+	if (meta->pool)
+	{
+		/* Only blocks that spilled to the heap need freeing, a reset does the rest */
+		Arena_Free(meta->pool, meta->arena);
+		Arena_Free(meta->pool, meta->stream.buffer);
+		__Wad_ReleaseArena(meta);
+	}
+
+	FSOPStreamClose(&meta->stream);
+
+	meta->arena  = NULL;
+	meta->header = NULL;
+	meta->certs  = meta->crl = meta->tik = meta->tmd = NULL;
+}
+
+/* Next WAD of a batch, read while the current one installs */
+enum
+{
+	WAD_PREFETCH_PRIORITY = 48,
+	WAD_PREFETCH_STACK    = 0x4000,
+};
+
+static struct
+{
+	char path[MAX_FILE_PATH_LEN];
+	WadMeta meta;
+	lwp_t thread;
+	bool pending;
+} gPrefetch = { .thread = LWP_THREAD_NULL };
+
+static void* __Wad_PrefetchThread(__attribute__((unused)) void* arg)
+{
+	FILE *fp = fopen(gPrefetch.path, "rb");
+
+	gPrefetch.meta.ret = fp ? __Wad_ReadMeta(fp, &gPrefetch.meta, FSOP_STREAM_BUFFER_SIZE) : -996;
+	return NULL;
+}
+
+static void __Wad_StartPrefetch(const char *path)
+{
+	memset(&gPrefetch.meta, 0, sizeof(WadMeta));
+	snprintf(gPrefetch.path, sizeof(gPrefetch.path), "%s", path);
+
+	__Wad_TakeArena(&gPrefetch.meta);
+
+	gPrefetch.pending = LWP_CreateThread(&gPrefetch.thread, __Wad_PrefetchThread, NULL, NULL, WAD_PREFETCH_STACK, WAD_PREFETCH_PRIORITY) >= 0;
+
+	if (!gPrefetch.pending)
+		__Wad_ReleaseArena(&gPrefetch.meta);
+}
+
+/* Waits for the reader, the caller owns gPrefetch.meta afterwards */
+static bool __Wad_FinishPrefetch(void)
+{
+	if (!gPrefetch.pending)
+		return false;
+
+	LWP_JoinThread(gPrefetch.thread, NULL);
+	gPrefetch.thread  = LWP_THREAD_NULL;
+	gPrefetch.pending = false;
+
+	return true;
+}
+
+void Wad_DropPrefetch(void)
+{
+	if (!__Wad_FinishPrefetch())
+		return;
+
+	__Wad_FreeMeta(&gPrefetch.meta);
+
+	if (gPrefetch.meta.fp)
+		fclose(gPrefetch.meta.fp);
+}
+
+static s32 __Wad_Install(WadMeta *meta)
 {
 	SetPRButtons(false);
-	wadHeader   *header  = NULL;
-	signed_blob *p_certs = NULL, *p_crl = NULL, *p_tik = NULL, *p_tmd = NULL;
+	wadHeader   *header  = meta->header;
+	signed_blob *p_certs = meta->certs, *p_crl = meta->crl, *p_tik = meta->tik, *p_tmd = meta->tmd;
+
+	FSOPStream *stream = &meta->stream;
+	WadPipeVerify verify;
 
-	SharedContent* sharedContents = NULL;
+	__aligned(0x20)
+	aeskey titleKey;
 
 	tmd *tmd_data  = NULL;
 
-	u32 cnt, offset = 0;
-	u32 sharedContentsCount = 0;
+	u32 cnt, offset = meta->offset;
 	int ret;
 	u64 tid;
 	bool retainPriiloader = false;
@@ -653,60 +961,25 @@ s32 Wad_Install(FILE *fp)
 
 	printf("\t\t>> Reading WAD data...");
 	fflush(stdout);
-	
-	ret = FSOPReadOpenFileA(fp, (void*)&header, offset, sizeof(wadHeader));
-	if (ret != 1)
-		goto err;
 
-	if (!__Wad_VerifyHeader(header))
-	{
-		ret = ES_EINVAL;
+	ret = meta->ret;
+	if (ret < 0)
 		goto err;
-	}
 
-	offset += round_up(header->header_len, 64);
-	
+	tid = ((tik *)SIGNATURE_PAYLOAD(p_tik))->titleid;
+
 	//Don't try to install boot2
-	__Wad_GetTitleID(fp, header, &tid);
-	
 	if (tid == TITLE_ID(1, 1))
 	{
 		printf("\n    I can't let you do that Dave\n");
 		ret = -999;
 		goto out;
 	}
-	
-	/* WAD certificates */
-	ret = FSOPReadOpenFileA(fp, (void*)&p_certs, offset, header->certs_len);
-	if (ret != 1)
-		goto err;
-
-	offset += round_up(header->certs_len, 64);
-		
-	/* WAD crl */
-	if (header->crl_len) {
-		ret = FSOPReadOpenFileA(fp, (void*)&p_crl, offset, header->crl_len);
-		if (ret != 1)
-			goto err;
-
-		offset += round_up(header->crl_len, 64);
-	}
-
-	/* WAD ticket */
-	ret = FSOPReadOpenFileA(fp, (void*)&p_tik, offset, header->tik_len);
-	if (ret != 1)
-		goto err;
 
 	bool isvWiiTitle = __Wad_FixTicket(p_tik);
 
-	offset += round_up(header->tik_len, 64);
-
-	/* WAD TMD */
-	ret = FSOPReadOpenFileA(fp, (void*)&p_tmd, offset, header->tmd_len);
-	if (ret != 1)
-		goto err;
-
-	offset += round_up(header->tmd_len, 64);
+	/* Korean common key titles go through ES unchecked */
+	bool verifyContents = gVerifyContents && __Wad_GetTitleKey(p_tik, titleKey);
 
 	Con_ClearLine();
 	
@@ -723,7 +996,9 @@ s32 Wad_Install(FILE *fp)
 			goto err;
 		}
 
-		if(tid == get_title_ios(TITLE_ID(1, 2)))
+		u8 protect = __Wad_GetProtection(tid);
+
+		if (protect & PROTECT_SYSMENU_IOS)
 		{
 			if (tmdIsStubIOS(tmd_data))
 			{
@@ -735,15 +1010,11 @@ s32 Wad_Install(FILE *fp)
 			// this code feels like a MESS
 			else if (!IS_WIIU && (tid == TITLE_ID(1, 70) || tid == TITLE_ID(1, 80)))
 			{
-				tik* ticket = (tik*)SIGNATURE_PAYLOAD(p_tik);
-
 				__aligned(0x10)
 				aeskey titlekey;
-				u64 iv[2] = { tid };
+				u64 iv[2] = {};
 
-
-				memcpy(titlekey, ticket->cipher_title_key, sizeof(aeskey));
-				AES_Decrypt(WiiCommonKey, sizeof(aeskey), iv, sizeof(iv), titlekey, titlekey, sizeof(aeskey));
+				__Wad_GetTitleKey(p_tik, titlekey);
 
 				u32 content0_offset = offset;
 				for (tmd_content* con = tmd_data->contents; con < tmd_data->contents + tmd_data->num_contents; con++)
@@ -755,7 +1026,7 @@ s32 Wad_Install(FILE *fp)
 				__aligned(0x20)
 				cIOSInfo build_tag = {};
 
-				ret = FSOPReadOpenFile(fp, (void*)&build_tag, content0_offset, sizeof(cIOSInfo));
+				ret = FSOPStreamRead(stream, (void*)&build_tag, content0_offset, sizeof(cIOSInfo));
 				if (ret != 1)
 					goto err;
 
@@ -779,10 +1050,7 @@ s32 Wad_Install(FILE *fp)
 			}
 		}
 		
-		if(tid  == get_title_ios(TITLE_ID(0x10008, 0x48414B00 | 'E'))
-		|| tid  == get_title_ios(TITLE_ID(0x10008, 0x48414B00 | 'P'))
-		|| tid  == get_title_ios(TITLE_ID(0x10008, 0x48414B00 | 'J'))
-		|| tid  == get_title_ios(TITLE_ID(0x10008, 0x48414B00 | 'K')))
+		if (protect & PROTECT_EULA_IOS)
 		{
 			if (tmdIsStubIOS(tmd_data))
 			{
@@ -792,10 +1060,7 @@ s32 Wad_Install(FILE *fp)
 			}
 		}
 		
-		if(tid == get_title_ios(TITLE_ID(0x10008, 0x48414C00 | 'E'))
-		|| tid == get_title_ios(TITLE_ID(0x10008, 0x48414C00 | 'P'))
-		|| tid == get_title_ios(TITLE_ID(0x10008, 0x48414C00 | 'J'))
-		|| tid == get_title_ios(TITLE_ID(0x10008, 0x48414C00 | 'K')))
+		if (protect & PROTECT_RGNSEL_IOS)
 		{
 			if (tmdIsStubIOS(tmd_data))
 			{
@@ -804,11 +1069,7 @@ s32 Wad_Install(FILE *fp)
 				goto err;
 			}
 		}
-		if(tid == get_title_ios(TITLE_ID(0x10001, 0x48415858))
-		|| tid == get_title_ios(TITLE_ID(0x10001, 0x4A4F4449))
-		|| tid == get_title_ios(TITLE_ID(0x10001, 0xAF1BF516))
-		|| tid == get_title_ios(TITLE_ID(0x10001, 0x4C554C5A))
-		|| tid == get_title_ios(TITLE_ID(0x10001, 0x4F484243)))
+		if (protect & PROTECT_HBC_IOS)
 		{
 			if (tmdIsStubIOS(tmd_data))
 			{
@@ -975,7 +1236,7 @@ skipChecks:
 		{
 			tmd_content* content = &tmd_data->contents[i];
 
-			if (Title_SharedContentPresent(content, sharedContents, sharedContentsCount))
+			if (Title_SharedContentPresent(content))
 				continue;
 
 			totalContentSize += round_up(content->size, 16384);
@@ -989,16 +1250,42 @@ skipChecks:
 	}
 #endif
 
+	/* ES keeps the contents it isn't given again, so only the changed ones are
+	 * written. Not for the System Menu, Priiloader sits in its boot content. */
+	const tmd *installed = NULL;
+	if (gSkipIdentical && !retainPriiloader && !cleanupPriiloader && tid != TITLE_ID(1, 2))
+		Title_LookupTMD(tid, &installed);
+
+	/* Missing contents are written again, whatever the TMD says */
+	if (installed && !Title_ContentsPresent(tid, installed))
+		installed = NULL;
+
 	printf("\t\t>> Installing ticket...");
 	fflush(stdout);
 
-	/* Install ticket */
+	/* Install ticket, also for an identical title, it may be the one missing */
 	ret = ES_AddTicket(p_tik, header->tik_len, p_certs, header->certs_len, p_crl, header->crl_len);
 	if (ret < 0)
 		goto err;
 
 	Con_ClearLine();
 
+	if (installed && installed->title_version == tmd_data->title_version && installed->num_contents == tmd_data->num_contents)
+	{
+		for (cnt = 0; cnt < tmd_data->num_contents; cnt++)
+		{
+			if (!__Wad_ContentInstalled(installed, &tmd_data->contents[cnt]))
+				break;
+		}
+
+		if (cnt == tmd_data->num_contents)
+		{
+			printf("\r\t\t>> Already installed, identical. Skipped.\n");
+			ret = 0;
+			goto out;
+		}
+	}
+
 	printf("\r\t\t>> Installing title...");
 	fflush(stdout);
 
@@ -1007,23 +1294,26 @@ skipChecks:
 	if (ret < 0)
 		goto err;
 
-	/* Get list of currently installed shared contents */
-	Title_GetSharedContents(&sharedContents, &sharedContentsCount);
-	
+	/* Currently installed shared contents, loaded once per session */
+	Title_LoadSharedIndex();
+
 	/* Install contents */
 	for (cnt = 0; cnt < tmd_data->num_contents; cnt++) 
 	{
 		tmd_content *content = &tmd_data->contents[cnt];
 
-		u32 idx = 0, len;
+		u32 len;
 		s32 cfd;
 
 		/* Encrypted content size */
 		len = round_up(content->size, 64);
 
-		if (Title_SharedContentPresent(content, sharedContents, sharedContentsCount))
+		if (Title_SharedContentPresent(content) || (installed && __Wad_ContentInstalled(installed, content)))
 		{
 			offset += len;
+
+			if (gProgress)
+				gProgress(cnt + 1, tmd_data->num_contents);
 			continue;
 		}
 
@@ -1039,41 +1329,26 @@ skipChecks:
 			goto err;
 		}
 
-		/* Install content data */
-		while (idx < len) 
-		{
-			u32 size;
-
-			/* Data length */
-			size = (len - idx);
-			if (size > BLOCK_SIZE)
-				size = BLOCK_SIZE;
-
-			/* Read data */
-			ret = FSOPReadOpenFile(fp, &wadBuffer, offset, size);
-			if (ret != 1)
-			{
-				ES_AddContentFinish(cfd);
-				goto err;
-			}
-				
-			/* Install data */
-			ret = ES_AddContentData(cfd, wadBuffer, size);
-			if (ret < 0)
-			{
-				ret = ES_AddContentFinish(cfd);
-				goto err;
-			}
+		/* Install content data, a bad hash stops before the last block */
+		if (verifyContents)
+			WadPipe_InitVerify(&verify, titleKey, content);
 
-			/* Increase variables */
-			idx    += size;
-			offset += size;
+		ret = WadPipe_Stream(stream, offset, len, cfd, verifyContents ? &verify : NULL);
+		if (ret < 0)
+		{
+			ES_AddContentFinish(cfd);
+			goto err;
 		}
 
+		offset += len;
+
 		/* Finish content installation */
 		ret = ES_AddContentFinish(cfd);
 		if (ret < 0)
 			goto err;
+
+		if (gProgress)
+			gProgress(cnt + 1, tmd_data->num_contents);
 	}
 	
 	Con_ClearLine();
@@ -1084,10 +1359,17 @@ skipChecks:
 	/* Finish title install */
 	ret = ES_AddTitleFinish();
 
+	/* Whatever ES did, what we know about the title may be stale now */
+	__Wad_TitleChanged(tmd_data->title_id);
+
 	if (ret >= 0) 
 	{
 		printf(" OK!\n");
 
+		/* ES added our shared contents to content.map */
+		for (cnt = 0; cnt < tmd_data->num_contents; cnt++)
+			Title_AddSharedContent(&tmd_data->contents[cnt]);
+
 		if (retainPriiloader)
 		{
 			printf("\r\t\t>> Moving System Menu...");
@@ -1195,27 +1477,172 @@ err:
 
 out:
 	/* Free memory */
-	free(header);
-	free(p_certs);
-	free(p_crl);
-	free(p_tik);
-	free(p_tmd);
-	free(sharedContents);
+	__Wad_FreeMeta(meta);
 
 	if (gForcedInstall)
-		return Wad_Install(fp);
+		return Wad_Install(meta->fp);
 	
 	SetPRButtons(true);
 	return ret;
 }
 
+s32 Wad_Install(FILE *fp)
+{
+	WadMeta meta = {};
+
+	meta.ret = __Wad_ReadMeta(fp, &meta, FSOP_STREAM_BUFFER_SIZE);
+
+	return __Wad_Install(&meta);
+}
+
+/* Installs a WAD by path, next is read in the background meanwhile */
+s32 Wad_InstallFile(const char *path, const char *next)
+{
+	WadMeta meta = {};
+
+	if (gPrefetch.pending && !strcmp(gPrefetch.path, path))
+	{
+		__Wad_FinishPrefetch();
+		meta = gPrefetch.meta;
+	}
+	else
+	{
+		Wad_DropPrefetch();
+
+		FILE *fp = fopen(path, "rb");
+		meta.ret = fp ? __Wad_ReadMeta(fp, &meta, FSOP_STREAM_BUFFER_SIZE) : -996;
+	}
+
+	if (next)
+		__Wad_StartPrefetch(next);
+
+	s32 ret = __Wad_Install(&meta);
+
+	if (meta.fp)
+		fclose(meta.fp);
+
+	return ret;
+}
+
+/* Dry run, decrypts and hashes every content without touching ES */
+s32 Wad_Verify(FILE *fp)
+{
+	WadMeta meta = {};
+	WadPipeVerify verify;
+
+	__aligned(0x20)
+	aeskey titleKey;
+
+	u32 cnt, offset;
+	s32 ret;
+
+	printf("\t\t>> Reading WAD data...");
+	fflush(stdout);
+
+	ret = __Wad_ReadMeta(fp, &meta, FSOP_STREAM_BUFFER_SIZE);
+	if (ret < 0)
+		goto err;
+
+	signed_blob *p_tik = meta.tik, *p_tmd = meta.tmd;
+	offset = meta.offset;
+
+	__Wad_FixTicket(p_tik);
+	if (!__Wad_GetTitleKey(p_tik, titleKey))
+	{
+		printf("\n    Can't verify titles using the Korean common key\n");
+		ret = -999;
+		goto out;
+	}
+
+	tmd *tmd_data = (tmd *)SIGNATURE_PAYLOAD(p_tmd);
+
+	for (cnt = 0; cnt < tmd_data->num_contents; cnt++)
+	{
+		tmd_content *content = &tmd_data->contents[cnt];
+		u32 len = round_up(content->size, 64);
+
+		Con_ClearLine();
+		printf("\r\t\t>> Verifying content #%02d...", content->cid);
+		fflush(stdout);
+
+		WadPipe_InitVerify(&verify, titleKey, content);
+
+		ret = WadPipe_Stream(&meta.stream, offset, len, -1, &verify);
+		if (ret < 0)
+			goto err;
+
+		offset += len;
+	}
+
+	Con_ClearLine();
+	printf("\r\t\t>> Verifying contents... OK!\n");
+	goto out;
+
+err:
+	printf("\n    ERROR! (ret = %d)\n", ret);
+
+	if (ret == 0 || ret == 1)
+		ret = -996;
+
+out:
+	__Wad_FreeMeta(&meta);
+
+	return ret;
+}
+
+/* Reads the header, ticket and TMD, nothing past them */
+s32 Wad_GetInfo(FILE *fp, WadInfo *info)
+{
+	WadMeta meta = {};
+
+	u32 cnt;
+	s32 ret;
+
+	memset(info, 0, sizeof(WadInfo));
+
+	/* Nothing past the TMD is needed, a small buffer will do */
+	ret = __Wad_ReadMeta(fp, &meta, BLOCK_SIZE);
+	if (ret < 0)
+		goto err;
+
+	signed_blob *p_tik = meta.tik, *p_tmd = meta.tmd;
+	tmd *tmd_data = (tmd *)SIGNATURE_PAYLOAD(p_tmd);
+
+	info->titleID     = tmd_data->title_id;
+	info->sysVersion  = tmd_data->sys_version;
+	info->version     = tmd_data->title_version;
+	info->numContents = tmd_data->num_contents;
+
+	for (cnt = 0; cnt < tmd_data->num_contents; cnt++)
+		info->contentSize += tmd_data->contents[cnt].size;
+
+	Title_ContentsHash(tmd_data, info->contentsHash);
+
+	if (tmdIsStubIOS(tmd_data))
+		info->flags |= WADINFO_STUB_IOS;
+
+	/* vWii common key */
+	if (((u8*)p_tik)[0x1F1] == 2 || tmd_data->vwii_title)
+		info->flags |= WADINFO_VWII;
+
+	ret = 0;
+	goto out;
+
+err:
+	if (ret >= 0)
+		ret = -996;
+
+out:
+	__Wad_FreeMeta(&meta);
+
+	return ret;
+}
+
 s32 Wad_Uninstall(FILE *fp)
 {
 	SetPRButtons(false);
-	wadHeader   *header   = NULL;
+	WadMeta      meta     = {};
 	tikview     *viewData = NULL;
-	signed_blob *s_tik    = NULL;
-	signed_blob *s_tmd    = NULL;
 
 	u64 tid;
 	u32 viewCnt;
@@ -1224,50 +1651,31 @@ s32 Wad_Uninstall(FILE *fp)
 	printf("\t\t>> Reading WAD data...");
 	fflush(stdout);
 
-	/* WAD header */
-	ret = FSOPReadOpenFileA(fp, (void*)&header, 0, sizeof(wadHeader));
-	if (ret != 1)
-	{
-		printf(" ERROR! (ret = %d)\n", ret);
-		goto out;
-	}
-
-	if (!__Wad_VerifyHeader(header))
+	/* Only the metadata, a small buffer will do */
+	ret = __Wad_ReadMeta(fp, &meta, BLOCK_SIZE);
+	if (ret == ES_EINVAL)
 	{
 		puts("\t\tInvalid WAD file?");
-		ret = ES_EINVAL;
 		goto out;
 	}
-
-	/* Get ticket */
-	u32 offset = 0;
-	offset += round_up(header->header_len, 0x40);
-	offset += round_up(header->certs_len,  0x40);
-	offset += round_up(header->crl_len,    0x40);
-
-	ret = FSOPReadOpenFileA(fp, (void*)&s_tik, offset, header->tik_len);
-	if (ret != 1) {
+	else if (ret < 0)
+	{
 		printf(" ERROR! (ret = %d)\n", ret);
 		goto out;
 	}
 
-	bool isvWiiTitle = __Wad_FixTicket(s_tik);
-	tik *ticket = SIGNATURE_PAYLOAD(s_tik);
+	bool isvWiiTitle = __Wad_FixTicket(meta.tik);
+	tik *ticket = SIGNATURE_PAYLOAD(meta.tik);
 	tid = ticket->titleid;
 
-	offset += round_up(header->tik_len, 0x40);
-	ret = FSOPReadOpenFileA(fp, (void*)&s_tmd, offset, header->tmd_len);
-	if (ret != 1) {
-		printf(" ERROR! (ret = %d)\n", ret);
-		goto out;
-	}
-
-	tmd* tmd_data = SIGNATURE_PAYLOAD(s_tmd);
+	tmd* tmd_data = SIGNATURE_PAYLOAD(meta.tmd);
 
 	//Assorted Checks
 	if (TITLE_UPPER(tid) == 0x1)
 	{
-		if (!get_title_ios(TITLE_ID(1, 2)))
+		u8 protect = __Wad_GetProtection(tid);
+
+		if (!gPolicy.sysMenuIOS)
 		{
 			printf("\n    I can't determine the System Menus IOS\nDeleting system titles is disabled\n");
 			ret = -999;
@@ -1299,17 +1707,13 @@ s32 Wad_Uninstall(FILE *fp)
 			ret = -999;
 			goto out;
 		}
-		if (tid == get_title_ios(TITLE_ID(1, 2)))
+		if (protect & PROTECT_SYSMENU_IOS)
 		{
 			printf("\n    I won't uninstall the System Menus IOS\n");
 			ret = -999;
 			goto out;
 		}
-		if (tid == get_title_ios(TITLE_ID(0x10001, 0x48415858))
-		||  tid == get_title_ios(TITLE_ID(0x10001, 0x4A4F4449))
-		||  tid == get_title_ios(TITLE_ID(0x10001, 0xAF1BF516))
-		||  tid == get_title_ios(TITLE_ID(0x10001, 0x4C554C5A))
-		||  tid == get_title_ios(TITLE_ID(0x10001, 0x4F484243)))
+		if (protect & PROTECT_HBC_IOS)
 		{
 			printf("\n    I won't uninstall the Homebrew Channel's IOS!\n");
 			ret = -999;
@@ -1317,8 +1721,7 @@ s32 Wad_Uninstall(FILE *fp)
 		}
 	}
 
-	char region = 0;
-	GetSysMenuRegion(NULL, &region);
+	char region = __Wad_GetPolicyRegion();
 	
 	if((tid  == TITLE_ID(0x10008, 0x48414B00 | 'E') || tid  == TITLE_ID(0x10008, 0x48414B00 | 'P') || tid  == TITLE_ID(0x10008, 0x48414B00 | 'J') || tid  == TITLE_ID(0x10008, 0x48414B00 | 'K') 
 	|| (tid  == TITLE_ID(0x10008, 0x48414C00 | 'E') || tid  == TITLE_ID(0x10008, 0x48414C00 | 'P') || tid  == TITLE_ID(0x10008, 0x48414C00 | 'J') || tid  == TITLE_ID(0x10008, 0x48414C00 | 'K')))
@@ -1340,13 +1743,13 @@ s32 Wad_Uninstall(FILE *fp)
 		ret = -999;
 		goto out;
 	}	
-	if(tid  == get_title_ios(TITLE_ID(0x10008, 0x48414B00 | region)))
+	if (__Wad_GetProtection(tid) & PROTECT_REGION_EULA_IOS)
 	{
 		printf("\n    I won't uninstall the EULAs IOS\n");
 		ret = -999;
 		goto out;
 	}	
-	if(tid  == get_title_ios(TITLE_ID(0x10008, 0x48414C00 | region)))
+	if (__Wad_GetProtection(tid) & PROTECT_REGION_RGNSEL_IOS)
 	{
 		printf("\n    I won't uninstall the rgnsel IOS\n");
 		ret = -999;
@@ -1414,9 +1817,11 @@ s32 Wad_Uninstall(FILE *fp)
 	else
 		printf(" OK!\n");
 
+	__Wad_TitleChanged(tid);
+
 out:
 	/* Free memory */
-	free(header);
+	__Wad_FreeMeta(&meta);
 
 	SetPRButtons(true);
 	return ret;
@@ -1,9 +1,45 @@
 #ifndef _WAD_H_
 #define _WAD_H_
 
+#include <stdio.h>
+#include <gctypes.h>
+
+#include "arena.h"
+
+/* What a WAD holds, read without installing it */
+enum
+{
+	WADINFO_STUB_IOS = 1 << 0,
+	WADINFO_VWII     = 1 << 1,
+};
+
+typedef struct
+{
+	u64 titleID;
+	u64 sysVersion;
+	u16 version;
+	u16 numContents;
+	u32 contentSize;
+	u32 flags;
+
+	/* SHA-1 of the TMD content records, see Title_ContentsHash */
+	u8  contentsHash[20];
+} ATTRIBUTE_PACKED WadInfo;
+
 /* Prototypes */
 s32 Wad_Install(FILE* fp);
+s32 Wad_InstallFile(const char* path, const char* next);
+void Wad_DropPrefetch(void);
 s32 Wad_Uninstall(FILE* fp);
+s32 Wad_Verify(FILE* fp);
+s32 Wad_GetInfo(FILE* fp, WadInfo* info);
+void Wad_SetVerify(bool enabled);
+void Wad_SetSkipIdentical(bool enabled);
+void Wad_SetProgress(void (*progress)(u32 done, u32 total));
+void Wad_FlushPolicy(void);
+void Wad_FreeArenas(void);
+void Wad_GetArenaStats(ArenaStats* out);
+void Wad_ResetArenaStats(void);
 const char* wad_strerror(int ec);
 
 s32 GetSysMenuRegion(u16* version, char* region);
@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <ogcsys.h>
+
+#include "wadindex.h"
+#include "fileops.h"
+#include "nand.h"
+#include "globals.h"
+
+/* Constants */
+#define WADINDEX_MAGIC		0x574D4958	// "WMIX"
+#define WADINDEX_VERSION	2
+
+/* On-disk layout, entries are kept sorted by filename */
+typedef struct
+{
+	u32 magic;
+	u32 version;
+	u32 count;
+	u32 entrySize;
+} ATTRIBUTE_PACKED WadIndexHeader;
+
+typedef struct
+{
+	char filename[128];
+
+	/* The entry is only trusted while these match the file */
+	u64 size;
+	u64 mtime;
+
+	WadInfo info;
+} ATTRIBUTE_PACKED WadIndexEntry;
+
+/* Index of the folder being browsed */
+static struct
+{
+	char folder[MAX_FILE_PATH_LEN];
+
+	WadIndexEntry* entries;
+	u32 count;
+	u32 size;
+
+	bool open;
+	bool dirty;
+} gIndex;
+
+/* Where an entry is or would go */
+static u32 __WadIndex_Find(const char* filename, bool* found)
+{
+	u32 lo = 0, hi = gIndex.count;
+
+	while (lo < hi)
+	{
+		u32 mid = (lo + hi) / 2;
+		int cmp = strcmp(gIndex.entries[mid].filename, filename);
+
+		if (!cmp)
+		{
+			*found = true;
+			return mid;
+		}
+
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	*found = false;
+	return lo;
+}
+
+static WadIndexEntry* __WadIndex_Insert(const char* filename)
+{
+	bool found;
+	u32 pos = __WadIndex_Find(filename, &found);
+
+	if (found)
+		return &gIndex.entries[pos];
+
+	if (gIndex.count == gIndex.size)
+	{
+		u32 size = gIndex.size ? gIndex.size * 2 : 64;
+		WadIndexEntry* entries = reallocarray(gIndex.entries, size, sizeof(WadIndexEntry));
+		if (!entries)
+			return NULL;
+
+		gIndex.entries = entries;
+		gIndex.size = size;
+	}
+
+	memmove(&gIndex.entries[pos + 1], &gIndex.entries[pos], (gIndex.count - pos) * sizeof(WadIndexEntry));
+	gIndex.count++;
+
+	WadIndexEntry* entry = &gIndex.entries[pos];
+	memset(entry, 0, sizeof(WadIndexEntry));
+	strncpy(entry->filename, filename, sizeof(entry->filename) - 1);
+
+	return entry;
+}
+
+s32 WadIndex_Open(const char* folder)
+{
+	char path[MAX_FILE_PATH_LEN];
+	WadIndexHeader header;
+
+	if (gIndex.open && !strcmp(gIndex.folder, folder))
+		return 0;
+
+	WadIndex_Close();
+
+	snprintf(gIndex.folder, sizeof(gIndex.folder), "%s", folder);
+	gIndex.open = true;
+
+	snprintf(path, sizeof(path), "%s/%s", folder, WADINDEX_FILENAME);
+
+	FILE* fp = fopen(path, "rb");
+	if (!fp)
+		return 0;
+
+	/* A stale or foreign index is simply rebuilt */
+	if (fread(&header, sizeof(header), 1, fp) != 1
+	||  header.magic != WADINDEX_MAGIC
+	||  header.version != WADINDEX_VERSION
+	||  header.entrySize != sizeof(WadIndexEntry))
+		goto out;
+
+	gIndex.entries = calloc(header.count, sizeof(WadIndexEntry));
+	if (!gIndex.entries)
+		goto out;
+
+	gIndex.size = header.count;
+	gIndex.count = fread(gIndex.entries, sizeof(WadIndexEntry), header.count, fp);
+
+	/* Lookups are a binary search on the names, a torn or unsorted index
+	 * would read past them or miss */
+	for (u32 i = 0; i < gIndex.count; i++)
+	{
+		const char* name = gIndex.entries[i].filename;
+
+		if (!memchr(name, 0, sizeof(gIndex.entries[i].filename))
+		||  (i && strcmp(gIndex.entries[i - 1].filename, name) >= 0))
+		{
+			free(gIndex.entries);
+			gIndex.entries = NULL;
+			gIndex.count = gIndex.size = 0;
+			break;
+		}
+	}
+
+out:
+	fclose(fp);
+	return 0;
+}
+
+s32 WadIndex_Get(const char* filename, WadInfo* info)
+{
+	char path[MAX_FILE_PATH_LEN];
+	struct stat st;
+	bool found;
+
+	if (!gIndex.open)
+		return -1;
+
+	snprintf(path, sizeof(path), "%s/%s", gIndex.folder, filename);
+
+	if (stat(path, &st) < 0)
+		return -1;
+
+	u32 pos = __WadIndex_Find(filename, &found);
+	if (found && gIndex.entries[pos].size == (u64)st.st_size && gIndex.entries[pos].mtime == (u64)st.st_mtime)
+	{
+		*info = gIndex.entries[pos].info;
+		return 0;
+	}
+
+	/* New or changed, read it again */
+	FILE* fp = fopen(path, "rb");
+	if (!fp)
+		return -1;
+
+	s32 ret = Wad_GetInfo(fp, info);
+	fclose(fp);
+
+	if (ret < 0)
+		return ret;
+
+	WadIndexEntry* entry = __WadIndex_Insert(filename);
+	if (entry)
+	{
+		entry->size  = st.st_size;
+		entry->mtime = st.st_mtime;
+		entry->info  = *info;
+		gIndex.dirty = true;
+	}
+
+	return 0;
+}
+
+void WadIndex_Prune(const fatFile* files, u32 count)
+{
+	u32 kept = 0;
+
+	if (!gIndex.count)
+		return;
+
+	bool* listed = calloc(gIndex.count, sizeof(bool));
+	if (!listed)
+		return;
+
+	for (const fatFile* f = files; f < files + count; f++)
+	{
+		bool found;
+		u32 pos = __WadIndex_Find(f->filename, &found);
+
+		if (found && f->iswad)
+			listed[pos] = true;
+	}
+
+	for (u32 i = 0; i < gIndex.count; i++)
+	{
+		if (listed[i])
+			gIndex.entries[kept++] = gIndex.entries[i];
+	}
+
+	if (kept != gIndex.count)
+	{
+		gIndex.count = kept;
+		gIndex.dirty = true;
+	}
+
+	free(listed);
+}
+
+void WadIndex_Close(void)
+{
+	char path[MAX_FILE_PATH_LEN];
+	char tmpPath[MAX_FILE_PATH_LEN];
+
+	if (gIndex.open && gIndex.dirty)
+	{
+		WadIndexHeader header = { WADINDEX_MAGIC, WADINDEX_VERSION, gIndex.count, sizeof(WadIndexEntry) };
+
+		snprintf(path, sizeof(path), "%s/%s", gIndex.folder, WADINDEX_FILENAME);
+		snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+
+		/* Write it aside first, a half written index is worse than none */
+		FILE* fp = fopen(tmpPath, "wb");
+		if (fp)
+		{
+			bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+				   && fwrite(gIndex.entries, sizeof(WadIndexEntry), gIndex.count, fp) == gIndex.count;
+
+			ok = !fclose(fp) && ok;
+
+			if (ok)
+			{
+				remove(path);
+				ok = !rename(tmpPath, path);
+			}
+
+			if (!ok)
+				remove(tmpPath);
+		}
+	}
+
+	free(gIndex.entries);
+	memset(&gIndex, 0, sizeof(gIndex));
+}
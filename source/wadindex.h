@@ -0,0 +1,16 @@
+#ifndef _WADINDEX_H_
+#define _WADINDEX_H_
+
+#include "wad.h"
+#include "fat.h"
+
+/* Constants */
+#define WADINDEX_FILENAME	"wmindex.bin"
+
+/* Prototypes */
+s32  WadIndex_Open(const char* folder);
+s32  WadIndex_Get(const char* filename, WadInfo* info);
+void WadIndex_Prune(const fatFile* files, u32 count);
+void WadIndex_Close(void);
+
+#endif
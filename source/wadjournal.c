@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ogcsys.h>
+
+#include "wadjournal.h"
+#include "nand.h"
+#include "globals.h"
+
+/* Constants */
+#define WADJOURNAL_MAGIC	0x574D424A	// "WMBJ"
+#define WADJOURNAL_VERSION	1
+
+/* On-disk layout, entries are in the order the batch runs them */
+typedef struct
+{
+	u32 magic;
+	u32 version;
+	u32 count;
+	u32 entrySize;
+} ATTRIBUTE_PACKED WadJournalHeader;
+
+typedef struct
+{
+	char filename[128];
+
+	u64 titleID;
+	u16 version;
+
+	/* Contents written so far, an interrupted WAD starts over */
+	u16 contentsDone;
+	u16 numContents;
+
+	u8  mode;
+	u8  state;
+	s32 ret;
+} ATTRIBUTE_PACKED WadJournalEntry;
+
+/* Journal of the running batch */
+static struct
+{
+	FILE* fp;
+	WadJournalEntry* entries;
+	u32 count;
+	u32 added;
+
+	/* Entry being installed, for content progress */
+	s32 current;
+
+	char path[MAX_FILE_PATH_LEN];
+} gJournal = { .current = -1 };
+
+static void __WadJournal_Path(char* path, size_t size, const char* folder)
+{
+	snprintf(path, size, "%s/%s", folder, WADJOURNAL_FILENAME);
+}
+
+/* Rewrites one entry in place, sync makes it survive a power cut */
+static void __WadJournal_Write(u32 index, bool sync)
+{
+	if (!gJournal.fp)
+		return;
+
+	if (fseek(gJournal.fp, sizeof(WadJournalHeader) + index * sizeof(WadJournalEntry), SEEK_SET) < 0)
+		return;
+
+	fwrite(&gJournal.entries[index], sizeof(WadJournalEntry), 1, gJournal.fp);
+	fflush(gJournal.fp);
+
+	if (sync)
+		fsync(fileno(gJournal.fp));
+}
+
+s32 WadJournal_Begin(const char* folder, u32 count)
+{
+	WadJournalHeader header = { WADJOURNAL_MAGIC, WADJOURNAL_VERSION, count, sizeof(WadJournalEntry) };
+
+	WadJournal_End();
+
+	gJournal.entries = calloc(count, sizeof(WadJournalEntry));
+	if (!gJournal.entries)
+		return -1;
+
+	__WadJournal_Path(gJournal.path, sizeof(gJournal.path), folder);
+
+	/* A batch still runs without a journal, e.g. on a read-only share */
+	gJournal.fp = fopen(gJournal.path, "wb");
+	if (!gJournal.fp)
+	{
+		free(gJournal.entries);
+		gJournal.entries = NULL;
+		return -1;
+	}
+
+	gJournal.count = count;
+	gJournal.added = 0;
+
+	fwrite(&header, sizeof(header), 1, gJournal.fp);
+	fwrite(gJournal.entries, sizeof(WadJournalEntry), count, gJournal.fp);
+	fflush(gJournal.fp);
+
+	return 0;
+}
+
+void WadJournal_Add(const char* filename, u8 mode, const WadInfo* info, bool done)
+{
+	if (!gJournal.fp || gJournal.added >= gJournal.count)
+		return;
+
+	WadJournalEntry* entry = &gJournal.entries[gJournal.added];
+
+	snprintf(entry->filename, sizeof(entry->filename), "%s", filename);
+	entry->mode  = mode;
+	entry->state = done ? WADJOURNAL_DONE : WADJOURNAL_PENDING;
+
+	if (info)
+	{
+		entry->titleID     = info->titleID;
+		entry->version     = info->version;
+		entry->numContents = info->numContents;
+	}
+
+	/* The whole plan goes to disk once, before anything is installed */
+	if (++gJournal.added == gJournal.count)
+	{
+		fseek(gJournal.fp, sizeof(WadJournalHeader), SEEK_SET);
+		fwrite(gJournal.entries, sizeof(WadJournalEntry), gJournal.count, gJournal.fp);
+		fflush(gJournal.fp);
+		fsync(fileno(gJournal.fp));
+	}
+}
+
+void WadJournal_SetState(u32 index, u8 state, s32 ret)
+{
+	if (!gJournal.fp || index >= gJournal.count)
+		return;
+
+	gJournal.entries[index].state = state;
+	gJournal.entries[index].ret   = ret;
+	gJournal.entries[index].contentsDone = 0;
+
+	gJournal.current = (state == WADJOURNAL_RUNNING) ? (s32)index : -1;
+
+	__WadJournal_Write(index, true);
+}
+
+void WadJournal_Progress(u32 done, u32 total)
+{
+	if (!gJournal.fp || gJournal.current < 0)
+		return;
+
+	WadJournalEntry* entry = &gJournal.entries[gJournal.current];
+	entry->contentsDone = done;
+	entry->numContents  = total;
+
+	/* Only informative, not worth a sync per content */
+	__WadJournal_Write(gJournal.current, false);
+}
+
+/* The batch ran to the end, nothing left to resume */
+void WadJournal_End(void)
+{
+	if (gJournal.fp)
+	{
+		fclose(gJournal.fp);
+		gJournal.fp = NULL;
+
+		remove(gJournal.path);
+	}
+
+	free(gJournal.entries);
+	gJournal.entries = NULL;
+	gJournal.count   = 0;
+	gJournal.added   = 0;
+	gJournal.current = -1;
+}
+
+/* What an interrupted batch still has to do, as marked list entries */
+s32 WadJournal_Load(const char* folder, fatFile** files, u32* done, u32* total)
+{
+	char path[MAX_FILE_PATH_LEN];
+	WadJournalHeader header;
+	WadJournalEntry entry;
+	u32 left = 0, read = 0;
+
+	*files = NULL;
+	*done  = 0;
+	*total = 0;
+
+	__WadJournal_Path(path, sizeof(path), folder);
+
+	FILE* fp = fopen(path, "rb");
+	if (!fp)
+		return 0;
+
+	/* A torn or foreign journal has nothing to resume */
+	if (fread(&header, sizeof(header), 1, fp) != 1
+	||  header.magic != WADJOURNAL_MAGIC
+	||  header.version != WADJOURNAL_VERSION
+	||  header.entrySize != sizeof(WadJournalEntry)
+	||  !header.count)
+		goto out;
+
+	*files = calloc(header.count, sizeof(fatFile));
+	if (!*files)
+		goto out;
+
+	for (; read < header.count; read++)
+	{
+		if (fread(&entry, sizeof(entry), 1, fp) != 1)
+			break;
+
+		/* Never got its plan written */
+		if (!entry.mode || !entry.filename[0])
+			continue;
+
+		(*total)++;
+
+		if (entry.state == WADJOURNAL_DONE)
+		{
+			(*done)++;
+			continue;
+		}
+
+		/* Interrupted and failed WADs are tried again */
+		fatFile* file = &(*files)[left++];
+		snprintf(file->filename, sizeof(file->filename), "%.*s", (int)sizeof(entry.filename) - 1, entry.filename);
+		file->install = entry.mode;
+		file->iswad   = true;
+	}
+
+out:
+	fclose(fp);
+
+	if (!left)
+	{
+		/* Stopped after its last WAD, nothing to resume. One that couldn't
+		 * be read in full may still be, it stays. */
+		if (*files && read == header.count)
+			remove(path);
+
+		free(*files);
+		*files = NULL;
+	}
+
+	return left;
+}
+
+void WadJournal_Discard(const char* folder)
+{
+	char path[MAX_FILE_PATH_LEN];
+
+	__WadJournal_Path(path, sizeof(path), folder);
+	remove(path);
+}
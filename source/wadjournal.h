@@ -0,0 +1,28 @@
+#ifndef _WADJOURNAL_H_
+#define _WADJOURNAL_H_
+
+#include "wad.h"
+#include "fat.h"
+
+/* Constants */
+#define WADJOURNAL_FILENAME	"wmbatch.bin"
+
+/* Entry states */
+enum
+{
+	WADJOURNAL_PENDING,
+	WADJOURNAL_RUNNING,
+	WADJOURNAL_DONE,
+	WADJOURNAL_FAILED,
+};
+
+/* Prototypes */
+s32  WadJournal_Begin(const char* folder, u32 count);
+void WadJournal_Add(const char* filename, u8 mode, const WadInfo* info, bool done);
+void WadJournal_SetState(u32 index, u8 state, s32 ret);
+void WadJournal_Progress(u32 done, u32 total);
+void WadJournal_End(void);
+s32  WadJournal_Load(const char* folder, fatFile** files, u32* done, u32* total);
+void WadJournal_Discard(const char* folder);
+
+#endif
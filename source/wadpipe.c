@@ -0,0 +1,394 @@
+#include <stdio.h>
+#include <string.h>
+#include <ogcsys.h>
+#include <ogc/es.h>
+#include <ogc/aes.h>
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
+#include <ogc/cond.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "title.h"
+#include "fileops.h"
+#include "malloc.h"
+#include "wadpipe.h"
+
+enum
+{
+	WADPIPE_THREAD_PRIORITY = 80,
+	WADPIPE_THREAD_STACK    = 0x4000,
+};
+
+/* Ring buffer slot */
+typedef struct
+{
+	u8* data;
+	u32 size;
+	s32 ret;
+} WadPipeSlot;
+
+static WadPipeSlot gSlots[WADPIPE_MAX_DEPTH];
+static u32 gDepth = WADPIPE_DEFAULT_DEPTH;
+static u32 gAllocated = 0;
+
+/* Decrypted data for verification, only the reader uses it */
+static u8* gPlain = NULL;
+
+static mutex_t gLock = LWP_MUTEX_NULL;
+static cond_t  gCond = LWP_COND_NULL;
+
+static WadPipeStats gStats;
+
+/* Current stream, shared with the reader thread */
+static struct
+{
+	FSOPStream* stream;
+	u32 offset;
+	u32 len;
+	WadPipeVerify* verify;
+
+	/* Blocks produced by the reader and consumed by ES */
+	u32 head;
+	u32 tail;
+
+	bool reading;
+	bool abort;
+} gJob;
+
+void WadPipe_SetDepth(u32 depth)
+{
+	if (depth < 1)
+		depth = 1;
+
+	if (depth > WADPIPE_MAX_DEPTH)
+		depth = WADPIPE_MAX_DEPTH;
+
+	gDepth = depth;
+}
+
+u32 WadPipe_GetDepth(void)
+{
+	return gDepth;
+}
+
+s32 WadPipe_Init(void)
+{
+	if (gLock == LWP_MUTEX_NULL && LWP_MutexInit(&gLock, false) < 0)
+		return -1;
+
+	if (gCond == LWP_COND_NULL && LWP_CondInit(&gCond) < 0)
+		return -1;
+
+	if (!gPlain)
+	{
+		gPlain = memalign32(BLOCK_SIZE);
+		if (!gPlain)
+			return -1;
+	}
+
+	/* Allocate missing buffers, keep the ones we already have */
+	for (; gAllocated < gDepth; gAllocated++)
+	{
+		gSlots[gAllocated].data = memalign32(BLOCK_SIZE);
+		if (!gSlots[gAllocated].data)
+			return -1;
+	}
+
+	gStats.depth = gDepth;
+
+	return 0;
+}
+
+void WadPipe_Deinit(void)
+{
+	while (gAllocated)
+	{
+		gAllocated--;
+		free(gSlots[gAllocated].data);
+		gSlots[gAllocated].data = NULL;
+	}
+
+	free(gPlain);
+	gPlain = NULL;
+
+	if (gCond != LWP_COND_NULL)
+	{
+		LWP_CondDestroy(gCond);
+		gCond = LWP_COND_NULL;
+	}
+
+	if (gLock != LWP_MUTEX_NULL)
+	{
+		LWP_MutexDestroy(gLock);
+		gLock = LWP_MUTEX_NULL;
+	}
+}
+
+void WadPipe_InitVerify(WadPipeVerify* verify, const aeskey titleKey, const tmd_content* content)
+{
+	memcpy(verify->key, titleKey, sizeof(aeskey));
+
+	/* Contents are encrypted with their index as IV */
+	memset(verify->iv, 0, sizeof(verify->iv));
+	verify->iv[0] = content->index >> 8;
+	verify->iv[1] = content->index;
+
+	verify->left = content->size;
+	memcpy(verify->hash, content->hash, sizeof(sha1));
+
+	SHA1Init(&verify->ctx);
+}
+
+/* Decrypts and hashes one block, checks the digest after the last one.
+ * The caller counts the time, the reader only touches gStats under gLock. */
+static s32 __WadPipe_Verify(WadPipeVerify* verify, const u8* data, u32 size, bool last)
+{
+	u8 next[16];
+
+	/* CBC chains on the last cipher block, whatever AES does with the IV */
+	memcpy(next, data + size - sizeof(next), sizeof(next));
+	AES_Decrypt(verify->key, sizeof(aeskey), verify->iv, sizeof(verify->iv), data, gPlain, size);
+	memcpy(verify->iv, next, sizeof(next));
+
+	u32 keep = (verify->left < size) ? (u32)verify->left : size;
+	SHA1Update(&verify->ctx, gPlain, keep);
+	verify->left -= keep;
+
+	s32 ret = 0;
+	if (last)
+	{
+		sha1 hash;
+		SHA1Final(hash, &verify->ctx);
+
+		if (verify->left || memcmp(hash, verify->hash, sizeof(sha1)))
+			ret = -1022;
+	}
+
+	return ret;
+}
+
+static void* __WadPipe_Reader(__attribute__((unused)) void* arg)
+{
+	u32 idx = 0;
+
+	while (idx < gJob.len)
+	{
+		u32 size = gJob.len - idx;
+		if (size > BLOCK_SIZE)
+			size = BLOCK_SIZE;
+
+		/* Wait for a free slot */
+		LWP_MutexLock(gLock);
+
+		if (gJob.head - gJob.tail >= gDepth && !gJob.abort)
+			gStats.readerStalls++;
+
+		while (gJob.head - gJob.tail >= gDepth && !gJob.abort)
+			LWP_CondWait(gCond, gLock);
+
+		if (gJob.abort)
+		{
+			LWP_MutexUnlock(gLock);
+			break;
+		}
+
+		WadPipeSlot* slot = &gSlots[gJob.head % gDepth];
+		gJob.reading = true;
+		LWP_MutexUnlock(gLock);
+
+		/* Read data */
+		u64 start = gettime();
+		s32 ret = FSOPStreamRead(gJob.stream, slot->data, gJob.offset + idx, size);
+		u32 elapsed = diff_usec(start, gettime());
+
+		ret = (ret == 1) ? 0 : -996;
+
+		/* A bad content never gets its last block written */
+		u32 verifyTime = 0;
+		if (!ret && gJob.verify)
+		{
+			start = gettime();
+			ret = __WadPipe_Verify(gJob.verify, slot->data, size, idx + size == gJob.len);
+			verifyTime = diff_usec(start, gettime());
+		}
+
+		/* Hand it over */
+		LWP_MutexLock(gLock);
+		gJob.reading = false;
+		gStats.readTime += elapsed;
+		gStats.verifyTime += verifyTime;
+		slot->size = size;
+		slot->ret  = ret;
+		gJob.head++;
+		LWP_CondBroadcast(gCond);
+		LWP_MutexUnlock(gLock);
+
+		if (ret < 0)
+			break;
+
+		idx += size;
+	}
+
+	return NULL;
+}
+
+static s32 __WadPipe_StreamDirect(FSOPStream* stream, u32 offset, u32 len, s32 cfd, WadPipeVerify* verify)
+{
+	WadPipeSlot* slot = &gSlots[0];
+	u32 idx = 0;
+	s32 ret;
+
+	while (idx < len)
+	{
+		u32 size = len - idx;
+		if (size > BLOCK_SIZE)
+			size = BLOCK_SIZE;
+
+		/* Read data */
+		u64 start = gettime();
+		ret = FSOPStreamRead(stream, slot->data, offset + idx, size);
+		gStats.readTime += diff_usec(start, gettime());
+
+		if (ret != 1)
+			return -996;
+
+		if (verify)
+		{
+			start = gettime();
+			ret = __WadPipe_Verify(verify, slot->data, size, idx + size == len);
+			gStats.verifyTime += diff_usec(start, gettime());
+
+			if (ret < 0)
+				return ret;
+		}
+
+		/* Install data */
+		if (cfd >= 0)
+		{
+			start = gettime();
+			ret = ES_AddContentData(cfd, slot->data, size);
+			gStats.writeTime += diff_usec(start, gettime());
+
+			if (ret < 0)
+				return ret;
+		}
+
+		gStats.blocks++;
+		gStats.bytes += size;
+
+		idx += size;
+	}
+
+	return 0;
+}
+
+s32 WadPipe_Stream(FSOPStream* stream, u32 offset, u32 len, s32 cfd, WadPipeVerify* verify)
+{
+	lwp_t reader = LWP_THREAD_NULL;
+	u32 idx = 0;
+	s32 ret = 0;
+
+	if (WadPipe_Init() < 0)
+		return -1;
+
+	/* Nothing to stream, but an empty content still has a hash */
+	if (!len && verify)
+	{
+		sha1 hash;
+		SHA1Final(hash, &verify->ctx);
+
+		return memcmp(hash, verify->hash, sizeof(sha1)) ? -1022 : 0;
+	}
+
+	/* Nothing to overlap with a single buffer */
+	if (gDepth < 2)
+		return __WadPipe_StreamDirect(stream, offset, len, cfd, verify);
+
+	gJob.stream  = stream;
+	gJob.offset  = offset;
+	gJob.len     = len;
+	gJob.verify  = verify;
+	gJob.head    = 0;
+	gJob.tail    = 0;
+	gJob.reading = false;
+	gJob.abort   = false;
+
+	if (LWP_CreateThread(&reader, __WadPipe_Reader, NULL, NULL, WADPIPE_THREAD_STACK, WADPIPE_THREAD_PRIORITY) < 0)
+		return __WadPipe_StreamDirect(stream, offset, len, cfd, verify);
+
+	while (idx < len)
+	{
+		/* Wait for data */
+		LWP_MutexLock(gLock);
+
+		if (gJob.head == gJob.tail)
+		{
+			u64 start = gettime();
+			gStats.writerStalls++;
+
+			while (gJob.head == gJob.tail)
+				LWP_CondWait(gCond, gLock);
+
+			gStats.stallTime += diff_usec(start, gettime());
+		}
+
+		WadPipeSlot* slot = &gSlots[gJob.tail % gDepth];
+		bool overlap = gJob.reading || (gJob.head - gJob.tail) > 1;
+		LWP_MutexUnlock(gLock);
+
+		if (slot->ret < 0)
+		{
+			ret = slot->ret;
+			break;
+		}
+
+		/* Install data */
+		u64 start = gettime();
+		ret = (cfd >= 0) ? ES_AddContentData(cfd, slot->data, slot->size) : 0;
+		u32 elapsed = diff_usec(start, gettime());
+
+		if (ret < 0)
+			break;
+
+		idx += slot->size;
+
+		/* Release the slot */
+		LWP_MutexLock(gLock);
+		gStats.writeTime += elapsed;
+		gStats.blocks++;
+		gStats.bytes += slot->size;
+		if (overlap)
+			gStats.overlapped++;
+
+		gJob.tail++;
+		LWP_CondBroadcast(gCond);
+		LWP_MutexUnlock(gLock);
+	}
+
+	/* Stop the reader if we bailed out early */
+	LWP_MutexLock(gLock);
+	gJob.abort = true;
+	LWP_CondBroadcast(gCond);
+	LWP_MutexUnlock(gLock);
+
+	LWP_JoinThread(reader, NULL);
+
+	return (ret < 0) ? ret : 0;
+}
+
+void WadPipe_GetStats(WadPipeStats* out)
+{
+	if (gLock != LWP_MUTEX_NULL)
+		LWP_MutexLock(gLock);
+
+	*out = gStats;
+
+	if (gLock != LWP_MUTEX_NULL)
+		LWP_MutexUnlock(gLock);
+}
+
+void WadPipe_ResetStats(void)
+{
+	memset(&gStats, 0, sizeof(gStats));
+	gStats.depth = gDepth;
+}
@@ -0,0 +1,67 @@
+#ifndef _WADPIPE_H_
+#define _WADPIPE_H_
+
+#include <ogc/es.h>
+
+#include "fileops.h"
+#include "sha1.h"
+
+/* Constants */
+#define WADPIPE_DEFAULT_DEPTH	2
+#define WADPIPE_MAX_DEPTH		8
+
+/* Content streaming statistics */
+typedef struct
+{
+	/* Ring depth in use */
+	u32 depth;
+
+	/* Blocks and bytes handed to ES */
+	u32 blocks;
+	u64 bytes;
+
+	/* Blocks written to ES while the reader was busy or had data queued */
+	u32 overlapped;
+
+	/* Reader waited for a free buffer (ES bound) */
+	u32 readerStalls;
+
+	/* ES writer waited for data (source device bound) */
+	u32 writerStalls;
+
+	/* Time spent reading, writing and waiting for data, in microseconds */
+	u64 readTime;
+	u64 writeTime;
+	u64 stallTime;
+
+	/* Time spent decrypting and hashing for verification, in microseconds */
+	u64 verifyTime;
+} WadPipeStats;
+
+/* Content verification, the plaintext is hashed as it streams past.
+ * Streaming with a negative cfd only verifies, nothing is written to ES. */
+typedef struct
+{
+	aeskey key ATTRIBUTE_ALIGN(32);
+	u8 iv[16] ATTRIBUTE_ALIGN(32);
+
+	/* Plaintext bytes still to hash, the rest is padding */
+	u64 left;
+
+	/* Hash from the TMD */
+	sha1 hash;
+
+	SHA1_CTX ctx;
+} WadPipeVerify;
+
+/* Prototypes */
+void WadPipe_SetDepth(u32 depth);
+u32  WadPipe_GetDepth(void);
+s32  WadPipe_Init(void);
+void WadPipe_Deinit(void);
+void WadPipe_InitVerify(WadPipeVerify* verify, const aeskey titleKey, const tmd_content* content);
+s32  WadPipe_Stream(FSOPStream* stream, u32 offset, u32 len, s32 cfd, WadPipeVerify* verify);
+void WadPipe_GetStats(WadPipeStats* out);
+void WadPipe_ResetStats(void);
+
+#endif
@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <string.h>
+#include <ogcsys.h>
+
+#include "wadplan.h"
+#include "title.h"
+#include "sys.h"
+
+/* Macros */
+#define TITLE_UPPER(x)		((u32)((x) >> 32))
+#define TITLE_LOWER(x)		((u32)(x))
+
+/* Order of the steps, stable within a class */
+enum
+{
+	CLASS_UNINSTALL_TITLE,
+	CLASS_UNINSTALL_IOS,
+	CLASS_INSTALL_IOS,
+	CLASS_INSTALL_TITLE,
+};
+
+static bool gSkipInstalled = false;
+
+void WadPlan_SetSkipInstalled(bool enabled)
+{
+	gSkipInstalled = enabled;
+}
+
+/* IOS slots, plus BC and MIOS which don't run on one either */
+static bool __WadPlan_IsIOS(const WadInfo* info)
+{
+	return TITLE_UPPER(info->titleID) == 1 && TITLE_UPPER(info->sysVersion) != 1;
+}
+
+static u32 __WadPlan_Class(const WadPlanStep* step)
+{
+	bool ios = (step->ret >= 0) && __WadPlan_IsIOS(&step->info);
+
+	if (step->mode == WADPLAN_UNINSTALL)
+		return ios ? CLASS_UNINSTALL_IOS : CLASS_UNINSTALL_TITLE;
+
+	return ios ? CLASS_INSTALL_IOS : CLASS_INSTALL_TITLE;
+}
+
+/* Same version with the same contents, and all of them on the NAND */
+static bool __WadPlan_Installed(const WadInfo* info)
+{
+	const tmd* tmd_data = NULL;
+	sha1 hash;
+
+	if (Title_LookupTMD(info->titleID, &tmd_data) < 0)
+		return false;
+
+	if (tmd_data->title_version != info->version || tmd_data->num_contents != info->numContents)
+		return false;
+
+	Title_ContentsHash(tmd_data, hash);
+	if (memcmp(hash, info->contentsHash, sizeof(sha1)))
+		return false;
+
+	return Title_ContentsPresent(info->titleID, tmd_data);
+}
+
+/* Uninstalled earlier in the batch, the NAND doesn't show that yet */
+static bool __WadPlan_Removed(const WadPlanStep* steps, u32 step, u64 tid)
+{
+	for (u32 i = 0; i < step; i++)
+	{
+		if (steps[i].mode == WADPLAN_UNINSTALL && steps[i].ret >= 0 && steps[i].info.titleID == tid)
+			return true;
+	}
+
+	return false;
+}
+
+void WadPlan_Build(WadPlanStep* steps, u32 count)
+{
+	/* IOS state as the batch goes along, read from the NAND on first use */
+	bool known[256] = {};
+	bool usable[256] = {};
+	bool fromBatch[256] = {};
+
+	/* Insertion sort, batches are short and the order within a class is the user's */
+	for (u32 i = 1; i < count; i++)
+	{
+		WadPlanStep step = steps[i];
+		u32 cls = __WadPlan_Class(&step);
+		u32 j = i;
+
+		for (; j > 0 && __WadPlan_Class(&steps[j - 1]) > cls; j--)
+			steps[j] = steps[j - 1];
+
+		steps[j] = step;
+	}
+
+	for (u32 i = 0; i < count; i++)
+	{
+		WadPlanStep* step = &steps[i];
+		const WadInfo* info = &step->info;
+
+		step->action   = WADPLAN_RUN;
+		step->batchIOS = false;
+
+		/* Couldn't read it, fail it before anything is written */
+		if (step->ret < 0)
+		{
+			step->action = WADPLAN_FAIL;
+			continue;
+		}
+
+		bool ios = __WadPlan_IsIOS(info) && TITLE_LOWER(info->titleID) < 256;
+		u8 slot = TITLE_LOWER(info->titleID);
+
+		if (step->mode == WADPLAN_UNINSTALL)
+		{
+			if (ios)
+			{
+				known[slot]     = true;
+				usable[slot]    = false;
+				fromBatch[slot] = false;
+			}
+
+			continue;
+		}
+
+		if (gSkipInstalled && !__WadPlan_Removed(steps, i, info->titleID) && __WadPlan_Installed(info))
+		{
+			step->action = WADPLAN_SKIP;
+			continue;
+		}
+
+		if (ios)
+		{
+			if (!known[slot])
+				usable[slot] = !isIOSstub(slot);
+
+			/* Only a stub or a missing IOS makes its titles depend on this one */
+			fromBatch[slot] = !usable[slot] && !(info->flags & WADINFO_STUB_IOS);
+			usable[slot]    = !(info->flags & WADINFO_STUB_IOS);
+			known[slot]     = true;
+
+			continue;
+		}
+
+		/* Everything else needs its IOS, from the NAND or from earlier in the batch */
+		if (TITLE_UPPER(info->sysVersion) != 1)
+			continue;
+
+		u8 need = TITLE_LOWER(info->sysVersion);
+		if (!known[need])
+		{
+			usable[need] = !isIOSstub(need);
+			known[need]  = true;
+		}
+
+		if (!usable[need])
+		{
+			step->action = WADPLAN_FAIL;
+			step->ret    = -1036;
+			continue;
+		}
+
+		step->batchIOS = fromBatch[need];
+	}
+}
+
+u32 WadPlan_Failed(WadPlanStep* steps, u32 count, u32 failed)
+{
+	const WadInfo* info = &steps[failed].info;
+	u32 marked = 0;
+
+	if (steps[failed].mode != WADPLAN_INSTALL || !__WadPlan_IsIOS(info) || TITLE_LOWER(info->titleID) >= 256)
+		return 0;
+
+	u32 slot = TITLE_LOWER(info->titleID);
+
+	for (u32 i = failed + 1; i < count; i++)
+	{
+		WadPlanStep* step = &steps[i];
+
+		if (step->action != WADPLAN_RUN || step->mode != WADPLAN_INSTALL)
+			continue;
+
+		/* Another copy of the same IOS takes over from here */
+		if (__WadPlan_IsIOS(&step->info))
+		{
+			if (TITLE_LOWER(step->info.titleID) == slot)
+				break;
+
+			continue;
+		}
+
+		if (step->batchIOS && TITLE_UPPER(step->info.sysVersion) == 1 && TITLE_LOWER(step->info.sysVersion) == slot)
+		{
+			step->action = WADPLAN_FAIL;
+			step->ret    = -1036;
+			marked++;
+		}
+	}
+
+	return marked;
+}
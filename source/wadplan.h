@@ -0,0 +1,41 @@
+#ifndef _WADPLAN_H_
+#define _WADPLAN_H_
+
+#include <gctypes.h>
+
+#include "wad.h"
+
+/* Requested operation */
+enum
+{
+	WADPLAN_INSTALL = 1,
+	WADPLAN_UNINSTALL,
+};
+
+/* What the plan does with a step */
+enum
+{
+	WADPLAN_RUN,
+	WADPLAN_SKIP,
+	WADPLAN_FAIL,
+};
+
+typedef struct
+{
+	/* Filled in by the caller, item is its own reference (list index) */
+	u32 item;
+	u8  mode;
+	s32 ret;
+	WadInfo info;
+
+	/* Filled in by the planner, ret holds the error when failing */
+	u8   action;
+	bool batchIOS;
+} WadPlanStep;
+
+/* Prototypes */
+void WadPlan_SetSkipInstalled(bool enabled);
+void WadPlan_Build(WadPlanStep* steps, u32 count);
+u32  WadPlan_Failed(WadPlanStep* steps, u32 count, u32 failed);
+
+#endif